@@ -0,0 +1,66 @@
+#ifndef BLOCK_SPARSE_MATRIX_H_
+#define BLOCK_SPARSE_MATRIX_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace GLOO {
+// Symmetric sparse matrix made of 3x3 blocks, one block row per particle.
+// Only the diagonal blocks and one block of each symmetric off-diagonal pair
+// are stored; the (col, row) block is implied to be the transpose.
+class BlockSparseMatrix {
+ public:
+  struct OffDiagonalBlock {
+    int row;
+    int col;
+    glm::mat3 block;
+  };
+
+  // Resets to an n x n block matrix of zeros, keeping allocated storage.
+  void Reset(size_t n) {
+    diagonal_.assign(n, glm::mat3(0.0f));
+    off_diagonal_.clear();
+  }
+
+  size_t GetNumBlockRows() const {
+    return diagonal_.size();
+  }
+
+  void AddDiagonal(int i, const glm::mat3& block) {
+    diagonal_[i] += block;
+  }
+
+  // Adds |block| at (row, col) and its transpose at (col, row).
+  void AddOffDiagonal(int row, int col, const glm::mat3& block) {
+    OffDiagonalBlock entry;
+    entry.row = row;
+    entry.col = col;
+    entry.block = block;
+    off_diagonal_.push_back(entry);
+  }
+
+  const std::vector<glm::mat3>& GetDiagonal() const {
+    return diagonal_;
+  }
+
+  // y = A * x
+  void Multiply(const std::vector<glm::vec3>& x,
+                std::vector<glm::vec3>& y) const {
+    y.resize(diagonal_.size());
+    for (size_t i = 0; i < diagonal_.size(); i++) {
+      y[i] = diagonal_[i] * x[i];
+    }
+    for (const auto& entry : off_diagonal_) {
+      y[entry.row] += entry.block * x[entry.col];
+      y[entry.col] += glm::transpose(entry.block) * x[entry.row];
+    }
+  }
+
+ private:
+  std::vector<glm::mat3> diagonal_;
+  std::vector<OffDiagonalBlock> off_diagonal_;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef CAPSULE_COLLIDER_H_
+#define CAPSULE_COLLIDER_H_
+
+#include <algorithm>
+
+#include "SphereCollider.hpp"
+
+namespace GLOO {
+// All points within |radius| of the local segment from |a| to |b|.
+class CapsuleCollider : public Collider {
+ public:
+  CapsuleCollider(const glm::vec3& a, const glm::vec3& b, float radius)
+      : a_(a), b_(b), radius_(radius) {
+  }
+
+  CapsuleCollider(const glm::vec3& a,
+                  const glm::vec3& b,
+                  float radius,
+                  KinematicPath path)
+      : Collider(std::move(path)), a_(a), b_(b), radius_(radius) {
+  }
+
+  void GetLocalBounds(glm::vec3& lo, glm::vec3& hi) const override {
+    lo = glm::min(a_, b_) - radius_;
+    hi = glm::max(a_, b_) + radius_;
+  }
+
+  bool FindContact(const glm::vec3& point,
+                   float margin,
+                   Contact& contact) const override {
+    glm::vec3 axis = b_ - a_;
+    float length_squared = glm::dot(axis, axis);
+    float u = length_squared > 0.0f
+                  ? glm::dot(point - a_, axis) / length_squared
+                  : 0.0f;
+    glm::vec3 closest = a_ + std::min(1.0f, std::max(0.0f, u)) * axis;
+    return SphereCollider::FindSphereContact(closest, radius_, point, margin,
+                                             contact);
+  }
+
+ private:
+  glm::vec3 a_;
+  glm::vec3 b_;
+  float radius_;
+};
+}  // namespace GLOO
+
+#endif
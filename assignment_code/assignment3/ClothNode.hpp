@@ -3,8 +3,12 @@
 
 #include "gloo/SceneNode.hpp"
 #include "IntegratorBase.hpp"
+#include "ClothSolverBase.hpp"
+#include "CollisionStage.hpp"
+#include "FixedStepScheduler.hpp"
 #include "ParticleState.hpp"
 #include "PendulumSystem.hpp"
+#include "RewindBuffer.hpp"
 
 #include "gloo/components/RenderingComponent.hpp"
 #include "gloo/components/ShadingComponent.hpp"
@@ -25,17 +29,56 @@ public:
               const ParticleState& initial_state,
               int grid_size)
         : integration_step_(integration_step),
+          scheduler_(integration_step),
           integrator_(std::move(integrator)),
           system_(system),
           state_(initial_state),
+          previous_positions_(initial_state.positions),
           initial_state_(initial_state),
-          time_(0.0f),
-          grid_size_(grid_size) {
-        
+          time_(0.0),
+          step_count_(0),
+          grid_size_(grid_size),
+          rewind_buffer_(kDefaultRewindBudget),
+          rewinding_(false) {
+        workspace_.adaptive_step = integration_step_;
+        rewind_buffer_.Record(step_count_, time_, state_);
+
         // Create visual representation
         CreateClothMesh();
     }
 
+    // Steps the cloth with |solver| instead of the integrator.
+    void SetSolver(std::unique_ptr<ClothSolverBase> solver) {
+        solver_ = std::move(solver);
+    }
+
+    // Adds |collider| to the collision stage, which pushes the cloth out of
+    // it after every step. |visual|, if given, is added as a child and
+    // follows the collider's translation.
+    void AddCollider(std::shared_ptr<const Collider> collider,
+                     std::unique_ptr<SceneNode> visual = nullptr) {
+        collision_stage_.SetThreadPool(system_->GetThreadPool());
+        if (visual != nullptr) {
+            visual->GetTransform().SetPosition(collider->GetTranslation(time_));
+            collider_visuals_.emplace_back(visual.get(), collider);
+            AddChild(std::move(visual));
+        }
+        collision_stage_.AddCollider(std::move(collider));
+    }
+
+    // Keeps particles not joined by a spring at least |distance| apart; 0
+    // turns self-collision off.
+    void SetSelfCollision(float distance) {
+        collision_stage_.SetThreadPool(system_->GetThreadPool());
+        collision_stage_.SetSelfCollision(system_->GetSprings(),
+                                          system_->GetNumParticles(), distance);
+    }
+
+    // Caps the memory kept for rewinding, dropping the oldest history.
+    void SetRewindBudget(size_t memory_budget) {
+        rewind_buffer_.SetMemoryBudget(memory_budget);
+    }
+
     void Update(double delta_time) override {
         // Check for reset key 'R'
         if (InputManager::GetInstance().IsKeyPressed('R')) {
@@ -43,14 +86,26 @@ public:
             return;
         }
 
+        // Hold 'B' to play the history backwards; the simulation resumes
+        // from the shown frame when the key is released.
+        if (InputManager::GetInstance().IsKeyPressed('B')) {
+            Rewind(delta_time);
+            UpdateClothMesh();
+            return;
+        }
+        if (rewinding_) {
+            ResumeFromRewind();
+        }
+
         // Integrate physics
-        float time_remaining = static_cast<float>(delta_time);
-        
-        while (time_remaining > 0.0f) {
-            float step = std::min(time_remaining, integration_step_);
-            state_ = integrator_->Integrate(*system_, state_, time_, step);
-            time_ += step;
-            time_remaining -= step;
+        int steps = scheduler_.Advance(delta_time);
+        if (steps > 0) {
+            // All but the last step in one batch; the last step's starting
+            // positions are kept for blending.
+            AdvanceSteps(steps - 1);
+            previous_positions_ = state_.positions;
+            AdvanceSteps(1);
+            rewind_buffer_.Record(step_count_, time_, state_);
         }
 
         // Update visual representation
@@ -58,6 +113,69 @@ public:
     }
 
 private:
+    void AdvanceSteps(int num_steps) {
+        if (!collision_stage_.IsEnabled()) {
+            IntegrateSteps(num_steps);
+            return;
+        }
+        // Contacts are resolved after every step, which edits the state
+        // behind the integrator's back.
+        for (int s = 0; s < num_steps; s++) {
+            IntegrateSteps(1);
+            if (collision_stage_.Apply(system_->GetParticles(), state_, time_)) {
+                workspace_.Invalidate();
+            }
+        }
+    }
+
+    void IntegrateSteps(int num_steps) {
+        if (solver_ != nullptr) {
+            for (int s = 0; s < num_steps; s++) {
+                solver_->Step(state_, time_, integration_step_);
+                time_ += integration_step_;
+            }
+        } else {
+            integrator_->IntegrateSteps(*system_, state_, time_, integration_step_,
+                                        num_steps, workspace_);
+            time_ += num_steps * static_cast<double>(integration_step_);
+        }
+        step_count_ += num_steps;
+    }
+
+    // Shows the recorded frame delta_time further back. Positions are
+    // decoded approximately; the exact state is rebuilt on resume.
+    void Rewind(double delta_time) {
+        if (rewind_buffer_.IsEmpty()) {
+            return;
+        }
+        if (!rewinding_) {
+            rewinding_ = true;
+            rewind_time_ = time_;
+        }
+        double oldest_time = rewind_buffer_.GetTime(rewind_buffer_.GetFirstFrame());
+        rewind_time_ = std::max(rewind_time_ - delta_time, oldest_time);
+        rewind_frame_ = rewind_buffer_.FindFrame(rewind_time_);
+        rewind_buffer_.DecodePositions(rewind_frame_, state_.positions);
+        previous_positions_ = state_.positions;
+        UpdateColliderVisuals(rewind_buffer_.GetTime(rewind_frame_));
+    }
+
+    // Restores the exact state of the rewound frame by re-simulating from its
+    // keyframe, and drops the recorded frames after it.
+    void ResumeFromRewind() {
+        rewinding_ = false;
+        uint64_t target_step = rewind_buffer_.GetStep(rewind_frame_);
+        state_ = rewind_buffer_.GetSnapshot(rewind_frame_, &step_count_, &time_);
+        scheduler_.Reset();
+        workspace_.Invalidate();
+        if (solver_ != nullptr) {
+            solver_->Reset();
+        }
+        AdvanceSteps(static_cast<int>(target_step - step_count_));
+        previous_positions_ = state_.positions;
+        rewind_buffer_.Truncate(rewind_frame_ + 1);
+    }
+
     void CreateClothMesh() {
         // Create a node for rendering the cloth as a wireframe
         cloth_node_ = make_unique<SceneNode>();
@@ -66,8 +184,8 @@ private:
         auto indices = make_unique<IndexArray>();
         
         // Add all particle positions
-        for (const auto& pos : state_.positions) {
-            positions->push_back(pos);
+        for (size_t i = 0; i < state_.positions.size(); i++) {
+            positions->push_back(RenderPosition(i));
         }
         
         // Create line segments for structural springs (horizontal and vertical)
@@ -103,33 +221,72 @@ private:
         AddChild(std::move(cloth_node_));
     }
 
+    // Position of particle i blended between the last two simulated states.
+    glm::vec3 RenderPosition(size_t i) const {
+        return glm::mix(previous_positions_[i], state_.positions[i],
+                        scheduler_.GetAlpha());
+    }
+
     void UpdateClothMesh() {
         auto positions = make_unique<PositionArray>();
         
         // Update all particle positions
-        for (const auto& pos : state_.positions) {
-            positions->push_back(pos);
+        for (size_t i = 0; i < state_.positions.size(); i++) {
+            positions->push_back(RenderPosition(i));
         }
         
         auto* rc = cloth_node_ptr_->GetComponentPtr<RenderingComponent>();
         if (rc != nullptr) {
             rc->GetVertexObjectPtr()->UpdatePositions(std::move(positions));
         }
+        if (!rewinding_) {
+            UpdateColliderVisuals(time_);
+        }
+    }
+
+    void UpdateColliderVisuals(double time) {
+        for (const auto& visual : collider_visuals_) {
+            visual.first->GetTransform().SetPosition(visual.second->GetTranslation(time));
+        }
     }
 
     void Reset() {
-        time_ = 0.0f;
+        time_ = 0.0;
+        step_count_ = 0;
         state_ = initial_state_;
+        previous_positions_ = state_.positions;
+        scheduler_.Reset();
+        workspace_.Invalidate();
+        if (solver_ != nullptr) {
+            solver_->Reset();
+        }
+        rewinding_ = false;
+        rewind_buffer_.Clear();
+        rewind_buffer_.Record(step_count_, time_, state_);
     }
 
     float integration_step_;
+    FixedStepScheduler scheduler_;
     std::unique_ptr<IntegratorBase<PendulumSystem, ParticleState>> integrator_;
+    std::unique_ptr<ClothSolverBase> solver_;
     std::shared_ptr<PendulumSystem> system_;
     ParticleState state_;
+    std::vector<glm::vec3> previous_positions_;
+    IntegratorWorkspace<ParticleState> workspace_;
     ParticleState initial_state_;
-    float time_;
+    double time_;
+    uint64_t step_count_;
     int grid_size_;
+
+    RewindBuffer rewind_buffer_;
+    bool rewinding_;
+    double rewind_time_;
+    uint64_t rewind_frame_;
     
+    CollisionStage collision_stage_;
+    // Non-owning pointers to child nodes that follow colliders.
+    std::vector<std::pair<SceneNode*, std::shared_ptr<const Collider>>> collider_visuals_;
+
     std::unique_ptr<SceneNode> cloth_node_;
     SceneNode* cloth_node_ptr_;
 };
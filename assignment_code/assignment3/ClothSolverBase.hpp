@@ -0,0 +1,23 @@
+#ifndef CLOTH_SOLVER_BASE_H_
+#define CLOTH_SOLVER_BASE_H_
+
+#include "ParticleState.hpp"
+
+namespace GLOO {
+// A cloth engine that advances the particle state directly instead of going
+// through ParticleSystemBase::ComputeTimeDerivative and an integrator.
+class ClothSolverBase {
+ public:
+  virtual ~ClothSolverBase() {
+  }
+
+  // Advances |state| in place by |dt|.
+  virtual void Step(ParticleState& state, double time, float dt) = 0;
+
+  // Called when the owning node resets its state.
+  virtual void Reset() {
+  }
+};
+}  // namespace GLOO
+
+#endif
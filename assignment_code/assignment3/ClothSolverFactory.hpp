@@ -0,0 +1,41 @@
+#ifndef CLOTH_SOLVER_FACTORY_H_
+#define CLOTH_SOLVER_FACTORY_H_
+
+#include <memory>
+#include <stdexcept>
+
+#include "ClothSolverBase.hpp"
+#include "ClothSolverType.hpp"
+#include "PendulumSystem.hpp"
+#include "ProjectiveDynamicsSolver.hpp"
+#include "XpbdSolver.hpp"
+
+namespace GLOO {
+class ClothSolverFactory {
+ public:
+  // Returns nullptr for MassSpring, which uses the integrator instead.
+  static std::unique_ptr<ClothSolverBase> CreateSolver(
+      ClothSolverType type,
+      std::shared_ptr<PendulumSystem> system,
+      float integration_step) {
+    switch (type) {
+      case ClothSolverType::MassSpring:
+        return nullptr;
+      case ClothSolverType::XPBD:
+        return std::unique_ptr<ClothSolverBase>(
+            new XpbdSolver(std::move(system), kXpbdIterations));
+      case ClothSolverType::ProjectiveDynamics:
+        return std::unique_ptr<ClothSolverBase>(new ProjectiveDynamicsSolver(
+            std::move(system), integration_step, kProjectiveIterations));
+      default:
+        throw std::runtime_error("Unrecognized cloth solver type!");
+    }
+  }
+
+ private:
+  static const int kXpbdIterations = 20;
+  static const int kProjectiveIterations = 10;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef CLOTH_SOLVER_TYPE_H_
+#define CLOTH_SOLVER_TYPE_H_
+
+#include <stdexcept>
+#include <string>
+
+namespace GLOO {
+// MassSpring integrates PendulumSystem forces with the selected integrator;
+// the others replace the integrator with a dedicated ClothSolverBase.
+enum class ClothSolverType { MassSpring, XPBD, ProjectiveDynamics };
+
+// The command line letter of each solver: m, x or p.
+inline ClothSolverType ParseClothSolverType(char letter) {
+  switch (letter) {
+    case 'm':
+      return ClothSolverType::MassSpring;
+    case 'x':
+      return ClothSolverType::XPBD;
+    case 'p':
+      return ClothSolverType::ProjectiveDynamics;
+    default:
+      throw std::runtime_error(
+          "Unrecognized cloth solver: " + std::string(1, letter) + ".");
+  }
+}
+}  // namespace GLOO
+
+#endif
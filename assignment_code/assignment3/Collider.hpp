@@ -0,0 +1,55 @@
+#ifndef COLLIDER_H_
+#define COLLIDER_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "KinematicPath.hpp"
+
+namespace GLOO {
+struct Contact {
+  // Nearest point outside the surface at the requested margin.
+  glm::vec3 position;
+  // Outward unit normal of the surface there.
+  glm::vec3 normal;
+};
+
+// A rigid obstacle for the cloth. Shapes are described in a local frame that
+// is translated along a kinematic path, so a collider can be static or swing
+// through the scene; its velocity is the path velocity.
+class Collider {
+ public:
+  // A collider at rest, with its local frame at the origin.
+  Collider() : path_(std::vector<Keyframe>{Keyframe{0.0, glm::vec3(0.0f)}}) {
+  }
+
+  explicit Collider(KinematicPath path) : path_(std::move(path)) {
+  }
+
+  virtual ~Collider() {
+  }
+
+  glm::vec3 GetTranslation(double time) const {
+    return path_.GetPosition(time);
+  }
+
+  glm::vec3 GetVelocity(double time) const {
+    return path_.GetVelocity(time);
+  }
+
+  // Axis-aligned bounds of the surface in the local frame.
+  virtual void GetLocalBounds(glm::vec3& lo, glm::vec3& hi) const = 0;
+
+  // If local |point| is inside the collider or closer than |margin| to its
+  // surface, fills |contact| (in the local frame) and returns true.
+  virtual bool FindContact(const glm::vec3& point,
+                           float margin,
+                           Contact& contact) const = 0;
+
+ private:
+  KinematicPath path_;
+};
+}  // namespace GLOO
+
+#endif
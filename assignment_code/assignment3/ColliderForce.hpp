@@ -0,0 +1,88 @@
+#ifndef COLLIDER_FORCE_H_
+#define COLLIDER_FORCE_H_
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "Collider.hpp"
+#include "ForceModule.hpp"
+
+namespace GLOO {
+// A penalty force keeping particles out of a collider: particles closer
+// than the thickness to the surface are pushed out by a spring on the
+// penetration depth, with damping on the approaching normal speed. The
+// force never pulls toward the surface.
+//
+// Unlike the CollisionStage, which moves particles onto the surface after
+// each step, this acts through the integrator, so contacts are smooth but
+// soft; stiff penalties need small steps with explicit integrators.
+// Particles are tested against the collider bounds first, which makes the
+// kernel a cheap pass over the particles far from it.
+template <class T>
+class ColliderForceT : public ForceModuleT<T> {
+ public:
+  typedef typename ForceModuleT<T>::State State;
+  typedef typename ForceModuleT<T>::Vec3 Vec3;
+
+  ColliderForceT(std::shared_ptr<const Collider> collider,
+                 float stiffness,
+                 float damping,
+                 float thickness)
+      : collider_(std::move(collider)),
+        stiffness_(stiffness),
+        damping_(damping),
+        thickness_(thickness) {
+  }
+
+  const std::shared_ptr<const Collider>& GetCollider() const {
+    return collider_;
+  }
+
+  const char* GetName() const override {
+    return "collider";
+  }
+
+  void AccumulateForces(const ForceContext& context,
+                        const State& state,
+                        double time,
+                        std::vector<Vec3>& forces) const override {
+    glm::vec3 translation = collider_->GetTranslation(time);
+    glm::vec3 velocity = collider_->GetVelocity(time);
+    glm::vec3 lo;
+    glm::vec3 hi;
+    collider_->GetLocalBounds(lo, hi);
+    lo -= thickness_;
+    hi += thickness_;
+    const std::vector<Particle>& particles = context.particles;
+    context.ParallelFor(forces.size(), [&](size_t begin, size_t end) {
+      Contact contact;
+      for (size_t i = begin; i < end; i++) {
+        glm::vec3 local = glm::vec3(state.positions[i]) - translation;
+        if (particles[i].fixed ||
+            !glm::all(glm::greaterThanEqual(local, lo)) ||
+            !glm::all(glm::lessThanEqual(local, hi)) ||
+            !collider_->FindContact(local, thickness_, contact)) {
+          continue;
+        }
+        float depth = glm::dot(contact.position - local, contact.normal);
+        float normal_speed =
+            glm::dot(glm::vec3(state.velocities[i]) - velocity, contact.normal);
+        float magnitude = std::max(
+            0.0f, stiffness_ * depth - damping_ * std::min(normal_speed, 0.0f));
+        forces[i] += Vec3(magnitude * contact.normal);
+      }
+    });
+  }
+
+ private:
+  std::shared_ptr<const Collider> collider_;
+  float stiffness_;
+  float damping_;
+  float thickness_;
+};
+
+typedef ColliderForceT<float> ColliderForce;
+}  // namespace GLOO
+
+#endif
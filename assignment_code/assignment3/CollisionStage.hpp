@@ -0,0 +1,299 @@
+#ifndef COLLISION_STAGE_H_
+#define COLLISION_STAGE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "Collider.hpp"
+#include "ParticleState.hpp"
+#include "ParticleTopology.hpp"
+#include "SpatialHash.hpp"
+#include "ThreadPool.hpp"
+
+namespace GLOO {
+// Resolves contacts between particles and colliders at the end of a step.
+// The particles are binned in a spatial hash, and each collider only
+// examines the particles in the cells overlapping its bounds, so the narrow
+// phase costs O(particles near colliders) however large the cloth is.
+//
+// A particle that got closer to a collider than the thickness is moved to
+// the surface, and its velocity relative to the collider loses the part
+// pointing inward, so a moving collider carries the cloth along. The
+// tangential part is slowed by Coulomb friction.
+//
+// Self-collision keeps particles that are not joined by a spring a minimum
+// distance apart. It reuses the same hash: each particle looks only at the
+// cells around it, so the cost is linear in the particle count. Every
+// particle gathers the corrections from all its close pairs into its own
+// slot (a Jacobi pass), so the query runs in parallel without write
+// conflicts and gives the same result for any thread count.
+class CollisionStage {
+ public:
+  CollisionStage() : thickness_(0.02f), friction_(0.3f), self_distance_(0.0f) {
+  }
+
+  void AddCollider(std::shared_ptr<const Collider> collider) {
+    colliders_.push_back(std::move(collider));
+  }
+
+  const std::vector<std::shared_ptr<const Collider>>& GetColliders() const {
+    return colliders_;
+  }
+
+  bool HasColliders() const {
+    return !colliders_.empty();
+  }
+
+  bool IsEnabled() const {
+    return HasColliders() || self_distance_ > 0.0f;
+  }
+
+  // Keeps particles not joined by one of |springs| at least |distance|
+  // apart, and sets the hash cell size to twice that, so each particle looks
+  // at 8 cells; 0 turns self-collision off. The distance should be below the
+  // rest distance of the closest unconnected particles, or the cloth is
+  // pushed apart at rest.
+  void SetSelfCollision(const std::vector<Spring>& springs,
+                        size_t num_particles,
+                        float distance) {
+    self_distance_ = distance;
+    if (distance > 0.0f) {
+      hash_.SetCellSize(2.0f * distance);
+    }
+    // Adjacency of the spring graph, as sorted lists per particle.
+    neighbor_start_.assign(num_particles + 1, 0);
+    for (const Spring& spring : springs) {
+      neighbor_start_[spring.particle1_index + 1]++;
+      neighbor_start_[spring.particle2_index + 1]++;
+    }
+    for (size_t i = 0; i < num_particles; i++) {
+      neighbor_start_[i + 1] += neighbor_start_[i];
+    }
+    neighbors_.resize(neighbor_start_[num_particles]);
+    std::vector<int> fill(neighbor_start_.begin(), neighbor_start_.end() - 1);
+    for (const Spring& spring : springs) {
+      neighbors_[fill[spring.particle1_index]++] = spring.particle2_index;
+      neighbors_[fill[spring.particle2_index]++] = spring.particle1_index;
+    }
+    for (size_t i = 0; i < num_particles; i++) {
+      std::sort(neighbors_.begin() + neighbor_start_[i],
+                neighbors_.begin() + neighbor_start_[i + 1]);
+    }
+  }
+
+  // Distance kept between particles and collider surfaces.
+  void SetThickness(float thickness) {
+    thickness_ = thickness;
+  }
+
+  // Ratio of tangential to normal speed lost in a contact.
+  void SetFriction(float friction) {
+    friction_ = friction;
+  }
+
+  // Edge of the hash cells; about the particle spacing works well. With
+  // self-collision it is clamped to at least twice the self-collision
+  // distance, as the neighbor query only visits 2 cells per axis.
+  void SetCellSize(float cell_size) {
+    hash_.SetCellSize(std::max(cell_size, 2.0f * self_distance_));
+  }
+
+  // Runs the narrow phase of each collider on |pool|. Particles are
+  // independent, so results do not depend on the thread count.
+  void SetThreadPool(std::shared_ptr<ThreadPool> pool) {
+    pool_ = std::move(pool);
+  }
+
+  // Separates close particles, then resolves contacts of the dynamic
+  // particles in |state| with the colliders placed at |time|, which thus
+  // have the last word. Returns whether any particle was moved.
+  template <class T>
+  bool Apply(const std::vector<Particle>& particles,
+             ParticleStateT<T>& state,
+             double time) {
+    if (!IsEnabled()) {
+      return false;
+    }
+    hash_.Build(state.positions);
+    bool moved = self_distance_ > 0.0f && SeparateParticles(particles, state);
+    for (const auto& collider : colliders_) {
+      glm::vec3 translation = collider->GetTranslation(time);
+      glm::vec3 lo;
+      glm::vec3 hi;
+      collider->GetLocalBounds(lo, hi);
+      lo += translation - thickness_;
+      hi += translation + thickness_;
+
+      candidates_.clear();
+      hash_.ForEachInBox(lo, hi, [&](int i) {
+        glm::vec3 p(state.positions[i]);
+        if (!particles[i].fixed && glm::all(glm::greaterThanEqual(p, lo)) &&
+            glm::all(glm::lessThanEqual(p, hi))) {
+          candidates_.push_back(i);
+        }
+      });
+      if (candidates_.empty()) {
+        continue;
+      }
+
+      glm::vec3 velocity = collider->GetVelocity(time);
+      std::atomic<bool> any_contact(false);
+      auto resolve = [&](size_t begin, size_t end) {
+        if (ResolveContacts(*collider, translation, velocity, state, begin,
+                            end)) {
+          any_contact = true;
+        }
+      };
+      RunParallel(candidates_.size(), resolve);
+      moved = moved || any_contact;
+    }
+    return moved;
+  }
+
+ private:
+  template <class F>
+  void RunParallel(size_t count, const F& fn) {
+    if (pool_ != nullptr) {
+      pool_->ParallelFor(count, fn);
+    } else {
+      fn(0, count);
+    }
+  }
+
+  bool AreNeighbors(int i, int j) const {
+    return std::binary_search(neighbors_.begin() + neighbor_start_[i],
+                              neighbors_.begin() + neighbor_start_[i + 1], j);
+  }
+
+  // One Jacobi pass of self-collision. Each close pair is pushed apart to
+  // the self-collision distance and loses its approaching normal velocity,
+  // split evenly between the two particles unless one is fixed. A particle
+  // averages the corrections of all its pairs.
+  template <class T>
+  bool SeparateParticles(const std::vector<Particle>& particles,
+                         ParticleStateT<T>& state) {
+    typedef typename ParticleStateT<T>::Vec3 Vec3;
+    size_t num_particles = state.positions.size();
+    if (neighbor_start_.size() != num_particles + 1) {
+      throw std::runtime_error(
+          "Self-collision was set up for a different particle count!");
+    }
+    position_corrections_.resize(num_particles);
+    velocity_corrections_.resize(num_particles);
+    const float distance = self_distance_;
+    std::atomic<bool> any_pair(false);
+
+    RunParallel(num_particles, [&](size_t begin, size_t end) {
+      bool found = false;
+      for (size_t i = begin; i < end; i++) {
+        glm::vec3 dx(0.0f);
+        glm::vec3 dv(0.0f);
+        int num_pairs = 0;
+        if (!particles[i].fixed) {
+          glm::vec3 xi(state.positions[i]);
+          glm::vec3 vi(state.velocities[i]);
+          hash_.ForEachNear(xi, distance, [&](int j) {
+            glm::vec3 d = xi - glm::vec3(state.positions[j]);
+            float distance_squared = glm::dot(d, d);
+            if (j == static_cast<int>(i) ||
+                distance_squared >= distance * distance ||
+                AreNeighbors(static_cast<int>(i), j)) {
+              return;
+            }
+            float length = std::sqrt(distance_squared);
+            // Coincident particles separate along y, in opposite directions.
+            glm::vec3 normal =
+                length > 1e-6f ? d / length
+                               : glm::vec3(0.0f, j > static_cast<int>(i) ? 1.0f
+                                                                       : -1.0f,
+                                           0.0f);
+            float share = particles[j].fixed ? 1.0f : 0.5f;
+            dx += share * (distance - length) * normal;
+            float normal_speed =
+                glm::dot(vi - glm::vec3(state.velocities[j]), normal);
+            if (normal_speed < 0.0f) {
+              dv -= share * normal_speed * normal;
+            }
+            num_pairs++;
+          });
+        }
+        if (num_pairs > 0) {
+          dx /= static_cast<float>(num_pairs);
+          dv /= static_cast<float>(num_pairs);
+          found = true;
+        }
+        position_corrections_[i] = dx;
+        velocity_corrections_[i] = dv;
+      }
+      if (found) {
+        any_pair = true;
+      }
+    });
+    if (!any_pair) {
+      return false;
+    }
+    RunParallel(num_particles, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        state.positions[i] += Vec3(position_corrections_[i]);
+        state.velocities[i] += Vec3(velocity_corrections_[i]);
+      }
+    });
+    return true;
+  }
+
+  // Narrow phase for candidates_[begin, end).
+  template <class T>
+  bool ResolveContacts(const Collider& collider,
+                       const glm::vec3& translation,
+                       const glm::vec3& collider_velocity,
+                       ParticleStateT<T>& state,
+                       size_t begin,
+                       size_t end) const {
+    typedef typename ParticleStateT<T>::Vec3 Vec3;
+    bool any_contact = false;
+    Contact contact;
+    for (size_t k = begin; k < end; k++) {
+      int i = candidates_[k];
+      glm::vec3 local = glm::vec3(state.positions[i]) - translation;
+      if (!collider.FindContact(local, thickness_, contact)) {
+        continue;
+      }
+      any_contact = true;
+      state.positions[i] = Vec3(contact.position + translation);
+
+      glm::vec3 relative = glm::vec3(state.velocities[i]) - collider_velocity;
+      float normal_speed = glm::dot(relative, contact.normal);
+      if (normal_speed < 0.0f) {
+        glm::vec3 tangential = relative - normal_speed * contact.normal;
+        float tangential_speed = glm::length(tangential);
+        float keep = tangential_speed > 0.0f
+                         ? std::max(0.0f, 1.0f + friction_ * normal_speed /
+                                                     tangential_speed)
+                         : 0.0f;
+        relative = keep * tangential;
+      }
+      state.velocities[i] = Vec3(collider_velocity + relative);
+    }
+    return any_contact;
+  }
+
+  std::vector<std::shared_ptr<const Collider>> colliders_;
+  float thickness_;
+  float friction_;
+  SpatialHash hash_;
+  std::shared_ptr<ThreadPool> pool_;
+  std::vector<int> candidates_;
+
+  float self_distance_;
+  std::vector<int> neighbor_start_;
+  std::vector<int> neighbors_;
+  std::vector<glm::vec3> position_corrections_;
+  std::vector<glm::vec3> velocity_corrections_;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef CONJUGATE_GRADIENT_H_
+#define CONJUGATE_GRADIENT_H_
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "BlockSparseMatrix.hpp"
+
+namespace GLOO {
+// Storage for an implicit step: the assembled system A x = b and the CG
+// vectors. Kept between steps so the solve does not allocate.
+struct LinearSolveWorkspace {
+  BlockSparseMatrix matrix;
+  std::vector<glm::vec3> rhs;
+  std::vector<glm::vec3> solution;
+
+  std::vector<glm::mat3> inverse_diagonal;
+  std::vector<glm::vec3> residual;
+  std::vector<glm::vec3> preconditioned;
+  std::vector<glm::vec3> direction;
+  std::vector<glm::vec3> product;
+};
+
+inline float Dot(const std::vector<glm::vec3>& a,
+                 const std::vector<glm::vec3>& b) {
+  float sum = 0.0f;
+  for (size_t i = 0; i < a.size(); i++) {
+    sum += glm::dot(a[i], b[i]);
+  }
+  return sum;
+}
+
+// Solves ws.matrix * ws.solution = ws.rhs for a symmetric positive definite
+// matrix with block-Jacobi preconditioned conjugate gradients, starting from
+// ws.solution = 0. Stops once the residual norm drops below |tolerance| times
+// the norm of the right-hand side. Returns the number of iterations taken.
+inline int SolveConjugateGradient(LinearSolveWorkspace& ws,
+                                  int max_iterations,
+                                  float tolerance) {
+  const BlockSparseMatrix& A = ws.matrix;
+  size_t n = A.GetNumBlockRows();
+
+  ws.inverse_diagonal.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    ws.inverse_diagonal[i] = glm::inverse(A.GetDiagonal()[i]);
+  }
+
+  ws.solution.assign(n, glm::vec3(0.0f));
+  ws.residual = ws.rhs;
+  ws.preconditioned.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    ws.preconditioned[i] = ws.inverse_diagonal[i] * ws.residual[i];
+  }
+  ws.direction = ws.preconditioned;
+
+  float rz = Dot(ws.residual, ws.preconditioned);
+  float threshold = tolerance * tolerance * Dot(ws.rhs, ws.rhs);
+  int iteration = 0;
+  while (iteration < max_iterations &&
+         Dot(ws.residual, ws.residual) > threshold) {
+    A.Multiply(ws.direction, ws.product);
+    float pq = Dot(ws.direction, ws.product);
+    if (pq <= 0.0f) {
+      break;
+    }
+    float alpha = rz / pq;
+    for (size_t i = 0; i < n; i++) {
+      ws.solution[i] += alpha * ws.direction[i];
+      ws.residual[i] -= alpha * ws.product[i];
+      ws.preconditioned[i] = ws.inverse_diagonal[i] * ws.residual[i];
+    }
+    float rz_next = Dot(ws.residual, ws.preconditioned);
+    float beta = rz_next / rz;
+    rz = rz_next;
+    for (size_t i = 0; i < n; i++) {
+      ws.direction[i] = ws.preconditioned[i] + beta * ws.direction[i];
+    }
+    iteration++;
+  }
+  return iteration;
+}
+}  // namespace GLOO
+
+#endif
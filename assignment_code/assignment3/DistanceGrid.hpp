@@ -0,0 +1,372 @@
+#ifndef DISTANCE_GRID_H_
+#define DISTANCE_GRID_H_
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.hpp"
+#include "MeshCollider.hpp"
+#include "ThreadPool.hpp"
+
+namespace GLOO {
+// Distance grid cache files: a 64-byte header followed by the float values,
+// x fastest, in native byte order.
+const char kDistanceGridMagic[8] = {'G', 'L', 'O', 'O', 'S', 'D', 'F', 'G'};
+const uint32_t kDistanceGridVersion = 1;
+
+struct DistanceGridHeader {
+  char magic[8];
+  uint32_t version;
+  int32_t size[3];
+  float origin[3];
+  float spacing;
+  float band;
+  uint32_t reserved;
+  // ComputeDistanceGridHash() of the mesh and settings it was baked from.
+  uint64_t source_hash;
+  uint64_t num_values;
+};
+static_assert(sizeof(DistanceGridHeader) == 64,
+              "Distance grid header must stay 64 bytes.");
+
+// FNV-1a over a mesh and the settings of its distance grid, so that a cache
+// file is only reused for the same input.
+inline uint64_t ComputeDistanceGridHash(
+    const std::vector<glm::vec3>& positions,
+    const std::vector<unsigned int>& indices,
+    int resolution,
+    float band) {
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](const void* data, size_t num_bytes) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t b = 0; b < num_bytes; b++) {
+      hash = (hash ^ bytes[b]) * 1099511628211ull;
+    }
+  };
+  uint64_t counts[2] = {positions.size(), indices.size()};
+  mix(counts, sizeof(counts));
+  mix(positions.data(), positions.size() * sizeof(glm::vec3));
+  mix(indices.data(), indices.size() * sizeof(unsigned int));
+  mix(&resolution, sizeof(resolution));
+  mix(&band, sizeof(band));
+  return hash;
+}
+
+// Signed distances to a surface sampled on a regular grid, negative inside.
+// Only a narrow band around the surface holds exact distances; farther nodes
+// hold plus or minus the band width. Lookups are a trilinear interpolation
+// of the 8 nodes around a point, with its analytic gradient, so they take
+// the same time wherever the point is and however detailed the surface.
+class DistanceGrid {
+ public:
+  DistanceGrid() : spacing_(1.0f), inverse_spacing_(1.0f), band_(0.0f) {
+  }
+
+  // Samples the signed distance to |mesh| at about |resolution| nodes along
+  // the longest side of its bounds. The band is widened to at least two
+  // cells, so that the sign of the far nodes can be flooded in from it.
+  static DistanceGrid Bake(const MeshCollider& mesh,
+                           int resolution,
+                           float band,
+                           ThreadPool* pool = nullptr) {
+    if (resolution < 2) {
+      throw std::runtime_error("Distance grid resolution must be at least 2!");
+    }
+    glm::vec3 lo;
+    glm::vec3 hi;
+    mesh.GetLocalBounds(lo, hi);
+    glm::vec3 extent = hi - lo;
+    float longest = std::max(extent.x, std::max(extent.y, extent.z));
+
+    DistanceGrid grid;
+    grid.spacing_ = (longest + 2.0f * band) / resolution;
+    grid.band_ = std::max(band, 2.0f * grid.spacing_);
+    float padding = grid.band_ + grid.spacing_;
+    grid.inverse_spacing_ = 1.0f / grid.spacing_;
+    grid.origin_ = lo - padding;
+    grid.size_ = glm::ivec3(glm::ceil((extent + 2.0f * padding) *
+                                      grid.inverse_spacing_)) +
+                 1;
+    grid.values_.assign(grid.GetNumValues(), FLT_MAX);
+
+    // Exact distances within the band, one z slice per task.
+    auto bake_slices = [&grid, &mesh](size_t begin, size_t end) {
+      for (int z = static_cast<int>(begin); z < static_cast<int>(end); z++) {
+        for (int y = 0; y < grid.size_.y; y++) {
+          for (int x = 0; x < grid.size_.x; x++) {
+            float distance;
+            if (mesh.FindSignedDistance(grid.GetNodePosition(x, y, z),
+                                        grid.band_, distance)) {
+              grid.values_[grid.GetIndex(x, y, z)] = distance;
+            }
+          }
+        }
+      }
+    };
+    if (pool != nullptr) {
+      pool->ParallelFor(grid.size_.z, bake_slices);
+    } else {
+      bake_slices(0, grid.size_.z);
+    }
+    grid.FloodSigns();
+    return grid;
+  }
+
+  // Reads a grid saved with |source_hash|. Returns false if the file does
+  // not exist or holds a grid of something else.
+  static bool Load(const std::string& path,
+                   uint64_t source_hash,
+                   DistanceGrid& grid) {
+    if (!std::ifstream(path).good()) {
+      return false;
+    }
+    std::unique_ptr<MappedFile> mapped;
+    try {
+      mapped.reset(new MappedFile(path));
+    } catch (const std::runtime_error&) {
+      // Empty or unreadable files are baked again.
+      return false;
+    }
+    const MappedFile& file = *mapped;
+    DistanceGridHeader header;
+    if (file.GetSize() < sizeof(header)) {
+      return false;
+    }
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if (std::memcmp(header.magic, kDistanceGridMagic, sizeof(header.magic)) !=
+            0 ||
+        header.version != kDistanceGridVersion ||
+        header.source_hash != source_hash || header.size[0] < 2 ||
+        header.size[1] < 2 || header.size[2] < 2 ||
+        header.num_values != static_cast<uint64_t>(header.size[0]) *
+                                 header.size[1] * header.size[2] ||
+        file.GetSize() != sizeof(header) + header.num_values * sizeof(float)) {
+      return false;
+    }
+    grid.size_ = glm::ivec3(header.size[0], header.size[1], header.size[2]);
+    grid.origin_ =
+        glm::vec3(header.origin[0], header.origin[1], header.origin[2]);
+    grid.spacing_ = header.spacing;
+    grid.inverse_spacing_ = 1.0f / header.spacing;
+    grid.band_ = header.band;
+    grid.values_.resize(header.num_values);
+    std::memcpy(grid.values_.data(), file.GetData() + sizeof(header),
+                header.num_values * sizeof(float));
+    return true;
+  }
+
+  // Writes the grid to a temporary file next to |path| and renames it into
+  // place once flushed, so |path| never holds a partly written grid. The
+  // header goes in last, so a torn temporary file fails Load() as well.
+  void Save(const std::string& path, uint64_t source_hash) const {
+    DistanceGridHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kDistanceGridMagic, sizeof(header.magic));
+    header.version = kDistanceGridVersion;
+    for (int k = 0; k < 3; k++) {
+      header.size[k] = size_[k];
+      header.origin[k] = origin_[k];
+    }
+    header.spacing = spacing_;
+    header.band = band_;
+    header.source_hash = source_hash;
+    header.num_values = values_.size();
+    size_t num_bytes = values_.size() * sizeof(float);
+    const std::string temporary_path = path + ".tmp";
+    try {
+      MappedFile file(temporary_path, sizeof(header) + num_bytes);
+      std::memcpy(file.GetData() + sizeof(header), values_.data(), num_bytes);
+      std::memcpy(file.GetData(), &header, sizeof(header));
+      file.Close();
+    } catch (const std::runtime_error&) {
+      std::remove(temporary_path.c_str());
+      throw;
+    }
+    // Windows does not rename over an existing file.
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0 &&
+        (std::remove(path.c_str()) != 0 ||
+         std::rename(temporary_path.c_str(), path.c_str()) != 0)) {
+      std::remove(temporary_path.c_str());
+      throw std::runtime_error("Cannot rename " + temporary_path + " to " +
+                               path);
+    }
+  }
+
+  const glm::ivec3& GetSize() const {
+    return size_;
+  }
+
+  float GetSpacing() const {
+    return spacing_;
+  }
+
+  float GetBand() const {
+    return band_;
+  }
+
+  size_t GetNumValues() const {
+    return static_cast<size_t>(size_.x) * size_.y * size_.z;
+  }
+
+  void GetBounds(glm::vec3& lo, glm::vec3& hi) const {
+    lo = origin_;
+    hi = origin_ + glm::vec3(size_ - 1) * spacing_;
+  }
+
+  // Interpolated signed distance at |point| and its gradient. Returns false
+  // outside the grid, which is farther than the band from the surface.
+  bool Sample(const glm::vec3& point,
+              float& distance,
+              glm::vec3& gradient) const {
+    glm::vec3 g = (point - origin_) * inverse_spacing_;
+    if (!(g.x >= 0.0f && g.y >= 0.0f && g.z >= 0.0f &&
+          g.x < size_.x - 1 && g.y < size_.y - 1 && g.z < size_.z - 1)) {
+      return false;
+    }
+    glm::ivec3 cell(g);
+    glm::vec3 f = g - glm::vec3(cell);
+    const size_t row = size_.x;
+    const size_t slice = row * size_.y;
+    const float* v = &values_[GetIndex(cell.x, cell.y, cell.z)];
+    // Corners c_xyz of the cell, then interpolation along x, y and z.
+    float c000 = v[0];
+    float c100 = v[1];
+    float c010 = v[row];
+    float c110 = v[row + 1];
+    float c001 = v[slice];
+    float c101 = v[slice + 1];
+    float c011 = v[slice + row];
+    float c111 = v[slice + row + 1];
+    float c00 = c000 + f.x * (c100 - c000);
+    float c10 = c010 + f.x * (c110 - c010);
+    float c01 = c001 + f.x * (c101 - c001);
+    float c11 = c011 + f.x * (c111 - c011);
+    float c0 = c00 + f.y * (c10 - c00);
+    float c1 = c01 + f.y * (c11 - c01);
+    distance = c0 + f.z * (c1 - c0);
+
+    float dx0 = (c100 - c000) + f.y * ((c110 - c010) - (c100 - c000));
+    float dx1 = (c101 - c001) + f.y * ((c111 - c011) - (c101 - c001));
+    float dy0 = c10 - c00;
+    float dy1 = c11 - c01;
+    gradient = glm::vec3(dx0 + f.z * (dx1 - dx0), dy0 + f.z * (dy1 - dy0),
+                         c1 - c0) *
+               inverse_spacing_;
+    return true;
+  }
+
+ private:
+  size_t GetIndex(int x, int y, int z) const {
+    return (static_cast<size_t>(z) * size_.y + y) * size_.x + x;
+  }
+
+  glm::vec3 GetNodePosition(int x, int y, int z) const {
+    return origin_ + glm::vec3(x, y, z) * spacing_;
+  }
+
+  // Gives every node outside the band the sign of the band nodes it is
+  // connected to, by a breadth-first flood through face neighbors. Nodes
+  // next to the flooded region are at least a cell away from the surface,
+  // so their sign is reliable. A grid without any surface is all outside.
+  void FloodSigns() {
+    std::deque<size_t> queue;
+    for (size_t i = 0; i < values_.size(); i++) {
+      if (values_[i] != FLT_MAX) {
+        queue.push_back(i);
+      }
+    }
+    if (queue.empty()) {
+      std::fill(values_.begin(), values_.end(), band_);
+      return;
+    }
+    const size_t row = size_.x;
+    const size_t slice = row * size_.y;
+    while (!queue.empty()) {
+      size_t i = queue.front();
+      queue.pop_front();
+      float far_value = values_[i] < 0.0f ? -band_ : band_;
+      int x = static_cast<int>(i % row);
+      int y = static_cast<int>(i / row % size_.y);
+      int z = static_cast<int>(i / slice);
+      size_t neighbors[6];
+      int num_neighbors = 0;
+      if (x > 0) {
+        neighbors[num_neighbors++] = i - 1;
+      }
+      if (x < size_.x - 1) {
+        neighbors[num_neighbors++] = i + 1;
+      }
+      if (y > 0) {
+        neighbors[num_neighbors++] = i - row;
+      }
+      if (y < size_.y - 1) {
+        neighbors[num_neighbors++] = i + row;
+      }
+      if (z > 0) {
+        neighbors[num_neighbors++] = i - slice;
+      }
+      if (z < size_.z - 1) {
+        neighbors[num_neighbors++] = i + slice;
+      }
+      for (int n = 0; n < num_neighbors; n++) {
+        if (values_[neighbors[n]] == FLT_MAX) {
+          values_[neighbors[n]] = far_value;
+          queue.push_back(neighbors[n]);
+        }
+      }
+    }
+  }
+
+  glm::vec3 origin_;
+  glm::ivec3 size_;
+  float spacing_;
+  float inverse_spacing_;
+  float band_;
+  std::vector<float> values_;
+};
+
+// Loads the distance grid of a mesh from |cache_path| if it was baked there
+// from the same |positions|, |indices| and settings, or else bakes it from
+// |mesh| and writes it there. An empty path only bakes. A cache that cannot
+// be written (read-only directory, full disk) is reported on stderr and the
+// baked grid is returned uncached.
+inline DistanceGrid LoadOrBakeDistanceGrid(
+    const MeshCollider& mesh,
+    const std::vector<glm::vec3>& positions,
+    const std::vector<unsigned int>& indices,
+    int resolution,
+    float band,
+    const std::string& cache_path,
+    ThreadPool* pool = nullptr) {
+  DistanceGrid grid;
+  uint64_t hash = ComputeDistanceGridHash(positions, indices, resolution, band);
+  if (!cache_path.empty() && DistanceGrid::Load(cache_path, hash, grid)) {
+    return grid;
+  }
+  grid = DistanceGrid::Bake(mesh, resolution, band, pool);
+  if (!cache_path.empty()) {
+    try {
+      grid.Save(cache_path, hash);
+    } catch (const std::exception& e) {
+      std::cerr << "Cannot cache distance grid in " << cache_path << ": "
+                << e.what() << std::endl;
+    }
+  }
+  return grid;
+}
+}  // namespace GLOO
+
+#endif
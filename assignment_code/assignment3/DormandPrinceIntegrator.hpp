@@ -0,0 +1,168 @@
+#ifndef DORMAND_PRINCE_INTEGRATOR_H_
+#define DORMAND_PRINCE_INTEGRATOR_H_
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "IntegratorBase.hpp"
+
+namespace GLOO {
+// Adaptive Runge-Kutta 5(4) of Dormand and Prince. Each call advances the
+// state by exactly dt, split into as few substeps as the error tolerance
+// allows. The embedded 4th-order solution gives the error estimate, and the
+// last stage of an accepted step is the first stage of the next one (FSAL),
+// so an accepted step costs six derivative evaluations.
+//
+// dt caps the substep: the nodes call this once per fixed step, so a calm
+// system still costs at least six evaluations per dt against RK4's four.
+// Adaptivity only pays off when the tolerance needs substeps below dt, so
+// give it a coarser dt than the fixed-step integrators.
+template <class TSystem, class TState>
+class DormandPrinceIntegrator
+    : public StaticIntegratorBase<DormandPrinceIntegrator<TSystem, TState>,
+                                  TSystem, TState> {
+ public:
+  DormandPrinceIntegrator(float relative_tolerance = 1e-3f,
+                          float absolute_tolerance = 1e-4f)
+      : relative_tolerance_(relative_tolerance),
+        absolute_tolerance_(absolute_tolerance) {
+  }
+
+  void Step(const TSystem& system,
+            TState& state,
+            double start_time,
+            float dt,
+            IntegratorWorkspace<TState>& workspace) const {
+    TState& k1 = workspace.Stage(0);
+    TState& k2 = workspace.Stage(1);
+    TState& k3 = workspace.Stage(2);
+    TState& k4 = workspace.Stage(3);
+    TState& k5 = workspace.Stage(4);
+    TState& k6 = workspace.Stage(5);
+    TState& k7 = workspace.Stage(6);
+    TState& temp_state = workspace.temp;
+
+    // Tableau weights are computed in the precision of the state.
+    typedef typename TState::Scalar Scalar;
+    double time = start_time;
+    double end_time = start_time + dt;
+    float h = workspace.adaptive_step > 0.0f ? workspace.adaptive_step : dt;
+
+    if (!workspace.first_same_as_last) {
+      system.ComputeTimeDerivative(state, time, k1);
+    }
+
+    while (time < end_time) {
+      // Land exactly on end_time rather than leaving a sliver for next call.
+      float remaining = static_cast<float>(end_time - time);
+      bool last = h >= remaining;
+      Scalar step = last ? remaining : h;
+
+      temp_state = state + k1 * (step * (Scalar(1) / 5));
+      system.ComputeTimeDerivative(temp_state, time + step * (Scalar(1) / 5),
+                                   k2);
+      temp_state = state +
+                   (k1 * (Scalar(3) / 40) + k2 * (Scalar(9) / 40)) * step;
+      system.ComputeTimeDerivative(temp_state, time + step * (Scalar(3) / 10),
+                                   k3);
+      temp_state = state + (k1 * (Scalar(44) / 45) + k2 * (Scalar(-56) / 15) +
+                            k3 * (Scalar(32) / 9)) * step;
+      system.ComputeTimeDerivative(temp_state, time + step * (Scalar(4) / 5),
+                                   k4);
+      temp_state = state + (k1 * (Scalar(19372) / 6561) +
+                            k2 * (Scalar(-25360) / 2187) +
+                            k3 * (Scalar(64448) / 6561) +
+                            k4 * (Scalar(-212) / 729)) * step;
+      system.ComputeTimeDerivative(temp_state, time + step * (Scalar(8) / 9),
+                                   k5);
+      temp_state = state + (k1 * (Scalar(9017) / 3168) +
+                            k2 * (Scalar(-355) / 33) +
+                            k3 * (Scalar(46732) / 5247) +
+                            k4 * (Scalar(49) / 176) +
+                            k5 * (Scalar(-5103) / 18656)) * step;
+      system.ComputeTimeDerivative(temp_state, time + step, k6);
+      temp_state = state + (k1 * (Scalar(35) / 384) +
+                            k3 * (Scalar(500) / 1113) +
+                            k4 * (Scalar(125) / 192) +
+                            k5 * (Scalar(-2187) / 6784) +
+                            k6 * (Scalar(11) / 84)) * step;
+      system.ComputeTimeDerivative(temp_state, time + step, k7);
+
+      // Difference between the 5th- and 4th-order solutions.
+      float error = ErrorNorm(
+          state, temp_state,
+          (k1 * (Scalar(71) / 57600) + k3 * (Scalar(-71) / 16695) +
+           k4 * (Scalar(71) / 1920) + k5 * (Scalar(-17253) / 339200) +
+           k6 * (Scalar(22) / 525) + k7 * (Scalar(-1) / 40)) * step);
+
+      float factor = error > 0.0f
+                         ? kSafety * std::pow(error, -1.0f / 5.0f)
+                         : kMaxGrowth;
+      factor = std::min(kMaxGrowth, std::max(kMinShrink, factor));
+
+      if (error <= 1.0f || step <= Scalar(kMinStep)) {
+        state = temp_state;
+        std::swap(k1, k7);
+        time = last ? end_time : time + step;
+        // A clipped final step says nothing about how large h could be.
+        if (!last || factor < 1.0f) {
+          h = static_cast<float>(step) * factor;
+        }
+      } else {
+        h = std::max(kMinStep, static_cast<float>(step) * factor);
+      }
+    }
+
+    workspace.adaptive_step = h;
+    workspace.first_same_as_last = true;
+  }
+
+ private:
+
+  // RMS of the error scaled by the mixed absolute/relative tolerance; a step
+  // is acceptable when this is at most 1.
+  template <class E>
+  float ErrorNorm(const TState& y0,
+                  const TState& y1,
+                  const state_expr::Expr<E>& error_expr) const {
+    typedef typename TState::Scalar Scalar;
+    const E& error = error_expr.Self();
+    size_t n = error.Size();
+    const Scalar* p0 = y0.FlatPositions();
+    const Scalar* p1 = y1.FlatPositions();
+    const Scalar* v0 = y0.FlatVelocities();
+    const Scalar* v1 = y1.FlatVelocities();
+    Scalar atol = absolute_tolerance_;
+    Scalar rtol = relative_tolerance_;
+    Scalar sum = 0;
+    for (size_t j = 0; j < n; j++) {
+      Scalar sp = atol + rtol * std::max(std::abs(p0[j]), std::abs(p1[j]));
+      Scalar sv = atol + rtol * std::max(std::abs(v0[j]), std::abs(v1[j]));
+      Scalar ep = error.Position(j) / sp;
+      Scalar ev = error.Velocity(j) / sv;
+      sum += ep * ep + ev * ev;
+    }
+    return n > 0 ? static_cast<float>(std::sqrt(sum / (2 * n))) : 0.0f;
+  }
+
+  static constexpr float kSafety = 0.9f;
+  static constexpr float kMinShrink = 0.2f;
+  static constexpr float kMaxGrowth = 5.0f;
+  static constexpr float kMinStep = 1e-6f;
+
+  float relative_tolerance_;
+  float absolute_tolerance_;
+};
+
+template <class TSystem, class TState>
+constexpr float DormandPrinceIntegrator<TSystem, TState>::kSafety;
+template <class TSystem, class TState>
+constexpr float DormandPrinceIntegrator<TSystem, TState>::kMinShrink;
+template <class TSystem, class TState>
+constexpr float DormandPrinceIntegrator<TSystem, TState>::kMaxGrowth;
+template <class TSystem, class TState>
+constexpr float DormandPrinceIntegrator<TSystem, TState>::kMinStep;
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef DRAG_FORCE_H_
+#define DRAG_FORCE_H_
+
+#include <vector>
+
+#include "ForceModule.hpp"
+
+namespace GLOO {
+// Linear drag in still air, -k * v on every particle. Linear in v, so the
+// implicit step treats it exactly.
+template <class T>
+class DragForceT : public ForceModuleT<T> {
+ public:
+  typedef typename ForceModuleT<T>::State State;
+  typedef typename ForceModuleT<T>::Vec3 Vec3;
+
+  explicit DragForceT(float drag_coefficient)
+      : drag_coefficient_(drag_coefficient) {
+  }
+
+  void SetDragCoefficient(float drag_coefficient) {
+    drag_coefficient_ = drag_coefficient;
+  }
+
+  float GetDragCoefficient() const {
+    return drag_coefficient_;
+  }
+
+  const char* GetName() const override {
+    return "drag";
+  }
+
+  void AccumulateForces(const ForceContext& context,
+                        const State& state,
+                        double time,
+                        std::vector<Vec3>& forces) const override {
+    T drag = drag_coefficient_;
+    context.ParallelFor(forces.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        forces[i] += -drag * state.velocities[i];
+      }
+    });
+  }
+
+  void AddImplicitTerms(const ForceContext& context,
+                        const State& state,
+                        float dt,
+                        BlockSparseMatrix& matrix,
+                        std::vector<glm::vec3>& rhs) const override {
+    const glm::mat3 block(dt * drag_coefficient_);
+    for (int i : context.dynamic_indices) {
+      matrix.AddDiagonal(i, block);
+    }
+  }
+
+ private:
+  float drag_coefficient_;
+};
+
+typedef DragForceT<float> DragForce;
+}  // namespace GLOO
+
+#endif
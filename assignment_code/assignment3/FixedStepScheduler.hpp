@@ -0,0 +1,73 @@
+#ifndef FIXED_STEP_SCHEDULER_H_
+#define FIXED_STEP_SCHEDULER_H_
+
+#include <cmath>
+
+namespace GLOO {
+// Decouples the simulation rate from the frame rate. Frame time accumulates
+// across frames and is spent in whole steps of a fixed size, so no frame ends
+// with a short remainder step. The time left over is reported as GetAlpha(),
+// the fraction of a step to interpolate between the last two simulated
+// states when rendering.
+//
+// A frame never takes more than max_steps_per_frame steps. Time beyond that
+// (e.g. after a stall from a window drag) is dropped, so the simulation slows
+// down for a frame instead of falling further and further behind.
+//
+// Adaptive integrators are scheduled the same way; the fixed step is then the
+// interval between outputs and caps the substeps the integrator chooses
+// inside it.
+class FixedStepScheduler {
+ public:
+  // By default allows up to |max_frame_time| seconds of simulation per frame.
+  explicit FixedStepScheduler(float step, float max_frame_time = 0.1f)
+      : step_(step), accumulator_(0.0) {
+    max_steps_per_frame_ = static_cast<int>(std::ceil(max_frame_time / step));
+    if (max_steps_per_frame_ < 1) {
+      max_steps_per_frame_ = 1;
+    }
+  }
+
+  void SetMaxStepsPerFrame(int max_steps_per_frame) {
+    max_steps_per_frame_ = max_steps_per_frame < 1 ? 1 : max_steps_per_frame;
+  }
+
+  // Adds a frame of |delta_time| seconds and returns how many steps of
+  // GetStep() to take for it.
+  int Advance(double delta_time) {
+    accumulator_ += delta_time;
+    double steps = std::floor(accumulator_ / step_);
+    if (steps > max_steps_per_frame_) {
+      accumulator_ = std::fmod(accumulator_, static_cast<double>(step_));
+      return max_steps_per_frame_;
+    }
+    accumulator_ -= steps * step_;
+    return static_cast<int>(steps);
+  }
+
+  float GetStep() const {
+    return step_;
+  }
+
+  int GetMaxStepsPerFrame() const {
+    return max_steps_per_frame_;
+  }
+
+  // Weight of the newest state when blending it with the one before, in
+  // [0, 1).
+  float GetAlpha() const {
+    return static_cast<float>(accumulator_ / step_);
+  }
+
+  void Reset() {
+    accumulator_ = 0.0;
+  }
+
+ private:
+  float step_;
+  int max_steps_per_frame_;
+  double accumulator_;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef FORCE_MODULE_H_
+#define FORCE_MODULE_H_
+
+#include <vector>
+
+#include "BlockSparseMatrix.hpp"
+#include "ParticleState.hpp"
+#include "ParticleTopology.hpp"
+#include "SpringColoring.hpp"
+#include "ThreadPool.hpp"
+
+namespace GLOO {
+// What force modules see of the system they are registered with: its
+// topology and the pool to run their kernels on.
+struct ForceContext {
+  const std::vector<Particle>& particles;
+  const std::vector<int>& dynamic_indices;
+  const std::vector<Spring>& springs;
+  const std::vector<Triangle>& triangles;
+  // Null for serial evaluation.
+  ThreadPool* pool;
+  // Conflict-free batches of |springs|; only set along with |pool|.
+  const SpringBatches* spring_batches;
+  // Bumped whenever particles or triangles are added, so modules can cache
+  // what they derive from them.
+  size_t topology_version;
+
+  ForceContext(const std::vector<Particle>& particles_in,
+               const std::vector<int>& dynamic_indices_in,
+               const std::vector<Spring>& springs_in,
+               const std::vector<Triangle>& triangles_in,
+               ThreadPool* pool_in,
+               const SpringBatches* spring_batches_in,
+               size_t topology_version_in)
+      : particles(particles_in),
+        dynamic_indices(dynamic_indices_in),
+        springs(springs_in),
+        triangles(triangles_in),
+        pool(pool_in),
+        spring_batches(spring_batches_in),
+        topology_version(topology_version_in) {
+  }
+
+  // Calls fn(begin, end) over [0, count), on the pool if there is one.
+  template <class F>
+  void ParallelFor(size_t count, const F& fn) const {
+    if (pool != nullptr) {
+      pool->ParallelFor(count, fn);
+    } else {
+      fn(0, count);
+    }
+  }
+};
+
+// One kind of force on the particles of a PendulumSystemT. The system sums
+// the modules registered with it, in order, into one force buffer; each
+// module adds its force on every particle in a single pass over the state,
+// so scenes only pay for the forces they use and each kernel can be timed
+// on its own.
+template <class T>
+class ForceModuleT {
+ public:
+  typedef ParticleStateT<T> State;
+  typedef typename State::Vec3 Vec3;
+
+  virtual ~ForceModuleT() {
+  }
+
+  // Short name, used to label profiles.
+  virtual const char* GetName() const = 0;
+
+  // Internal forces act along springs. Constraint solvers, which enforce
+  // the springs themselves, skip them.
+  virtual bool IsInternal() const {
+    return false;
+  }
+
+  // Adds the force on each particle of |state| at |time| to |forces|.
+  // Forces on fixed particles are ignored by the system.
+  virtual void AccumulateForces(const ForceContext& context,
+                                const State& state,
+                                double time,
+                                std::vector<Vec3>& forces) const = 0;
+
+  // Adds -dt * df/dv - dt^2 * df/dx to |matrix| and dt * df/dx * v to
+  // |rhs|, which holds the forces, for a backward Euler step of size |dt|.
+  // Rows of fixed particles must be left alone. Modules that add nothing
+  // are integrated explicitly within the implicit step.
+  virtual void AddImplicitTerms(const ForceContext& context,
+                                const State& state,
+                                float dt,
+                                BlockSparseMatrix& matrix,
+                                std::vector<glm::vec3>& rhs) const {
+  }
+
+  // Potential energy of conservative forces, zero for the others.
+  virtual T ComputePotentialEnergy(const ForceContext& context,
+                                   const State& state) const {
+    return T(0);
+  }
+};
+
+typedef ForceModuleT<float> ForceModule;
+}  // namespace GLOO
+
+#endif
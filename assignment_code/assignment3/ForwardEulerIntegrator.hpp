@@ -5,14 +5,19 @@
 
 namespace GLOO {
 template <class TSystem, class TState>
-class ForwardEulerIntegrator : public IntegratorBase<TSystem, TState> {
-  TState Integrate(const TSystem& system,
-                   const TState& state,
-                   float start_time,
-                   float dt) const override {
+class ForwardEulerIntegrator
+    : public StaticIntegratorBase<ForwardEulerIntegrator<TSystem, TState>,
+                                  TSystem, TState> {
+ public:
+  void Step(const TSystem& system,
+            TState& state,
+            double start_time,
+            float dt,
+            IntegratorWorkspace<TState>& workspace) const {
     // Forward Euler
-    TState f0 = system.ComputeTimeDerivative(state, start_time);
-    return state + f0 * dt;
+    TState& f0 = workspace.Stage(0);
+    system.ComputeTimeDerivative(state, start_time, f0);
+    state = state + f0 * dt;
   }
 };
 }  // namespace GLOO
@@ -0,0 +1,64 @@
+#ifndef GRAVITY_FORCE_H_
+#define GRAVITY_FORCE_H_
+
+#include <vector>
+
+#include "ForceModule.hpp"
+
+namespace GLOO {
+// Uniform gravity, m * g on every particle.
+template <class T>
+class GravityForceT : public ForceModuleT<T> {
+ public:
+  typedef typename ForceModuleT<T>::State State;
+  typedef typename ForceModuleT<T>::Vec3 Vec3;
+
+  explicit GravityForceT(const glm::vec3& gravity = glm::vec3(0.0f, -9.8f,
+                                                              0.0f))
+      : gravity_(gravity) {
+  }
+
+  void SetGravity(const glm::vec3& gravity) {
+    gravity_ = gravity;
+  }
+
+  const glm::vec3& GetGravity() const {
+    return gravity_;
+  }
+
+  const char* GetName() const override {
+    return "gravity";
+  }
+
+  void AccumulateForces(const ForceContext& context,
+                        const State& state,
+                        double time,
+                        std::vector<Vec3>& forces) const override {
+    Vec3 gravity(gravity_);
+    const std::vector<Particle>& particles = context.particles;
+    context.ParallelFor(forces.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        forces[i] += T(particles[i].mass) * gravity;
+      }
+    });
+  }
+
+  T ComputePotentialEnergy(const ForceContext& context,
+                           const State& state) const override {
+    T energy = 0;
+    Vec3 gravity(gravity_);
+    for (int i : context.dynamic_indices) {
+      energy -= T(context.particles[i].mass) *
+                glm::dot(gravity, state.positions[i]);
+    }
+    return energy;
+  }
+
+ private:
+  glm::vec3 gravity_;
+};
+
+typedef GravityForceT<float> GravityForce;
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef IMPLICIT_EULER_INTEGRATOR_H_
+#define IMPLICIT_EULER_INTEGRATOR_H_
+
+#include "IntegratorBase.hpp"
+
+namespace GLOO {
+// Backward Euler in the style of Baraff and Witkin, "Large Steps in Cloth
+// Simulation": the step is linearized around the current state and the
+// velocity change is found with preconditioned conjugate gradients. Stays
+// stable for stiff springs at frame-sized steps.
+template <class TSystem, class TState>
+class ImplicitEulerIntegrator
+    : public StaticIntegratorBase<ImplicitEulerIntegrator<TSystem, TState>,
+                                  TSystem, TState> {
+ public:
+  ImplicitEulerIntegrator(int max_cg_iterations = 100,
+                          float cg_tolerance = 1e-4f)
+      : max_cg_iterations_(max_cg_iterations), cg_tolerance_(cg_tolerance) {
+  }
+
+  void Step(const TSystem& system,
+            TState& state,
+            double start_time,
+            float dt,
+            IntegratorWorkspace<TState>& workspace) const {
+    LinearSolveWorkspace& solve = workspace.linear_solve;
+    if (!system.AssembleImplicitSystem(state, start_time, dt, solve)) {
+      IntegrateFixedPoint(system, state, start_time, dt, workspace);
+      return;
+    }
+    SolveConjugateGradient(solve, max_cg_iterations_, cg_tolerance_);
+
+    // The linear solve is single precision; the update uses the state's.
+    typedef typename TState::Scalar Scalar;
+    typedef typename TState::Vec3 Vec3;
+    const Scalar h = dt;
+    for (size_t i = 0; i < state.positions.size(); i++) {
+      state.velocities[i] += Vec3(solve.solution[i]);
+      state.positions[i] += h * state.velocities[i];
+    }
+  }
+
+ private:
+
+  // Backward Euler for systems without force Jacobians: solves
+  // y1 = y0 + dt * f(y1) by fixed-point iteration from a forward Euler guess.
+  void IntegrateFixedPoint(const TSystem& system,
+                           TState& state,
+                           double start_time,
+                           float dt,
+                           IntegratorWorkspace<TState>& workspace) const {
+    TState& f = workspace.Stage(0);
+    TState& next_state = workspace.temp;
+    next_state = state;
+    for (int iteration = 0; iteration < kFixedPointIterations; iteration++) {
+      system.ComputeTimeDerivative(next_state, start_time + dt, f);
+      next_state = state + f * dt;
+    }
+    state = next_state;
+  }
+
+  static const int kFixedPointIterations = 4;
+
+  int max_cg_iterations_;
+  float cg_tolerance_;
+};
+}  // namespace GLOO
+
+#endif
@@ -2,6 +2,7 @@
 #define INTEGRATOR_BASE_H_
 
 #include "ParticleSystemBase.hpp"
+#include "IntegratorWorkspace.hpp"
 
 namespace GLOO {
 template <class TSystem, class TState>
@@ -10,10 +11,89 @@ class IntegratorBase {
   virtual ~IntegratorBase() {
   }
 
-  virtual TState Integrate(const TSystem& system,
-                           const TState& state,
-                           float start_time,
-                           float dt) const = 0;
+  // Advances |state| in place by |dt|. All scratch storage comes from
+  // |workspace|, so repeated calls do not allocate.
+  virtual void Integrate(const TSystem& system,
+                         TState& state,
+                         double start_time,
+                         float dt,
+                         IntegratorWorkspace<TState>& workspace) const = 0;
+
+  // Takes |num_steps| steps of |dt|, snapping kinematic particles onto their
+  // paths after each one. Implemented with static dispatch, so this costs
+  // one virtual call per batch rather than per step or per derivative.
+  virtual void IntegrateSteps(const TSystem& system,
+                              TState& state,
+                              double start_time,
+                              float dt,
+                              int num_steps,
+                              IntegratorWorkspace<TState>& workspace) const = 0;
+
+  // Convenience wrapper that returns the next state. Allocates a fresh
+  // workspace on every call; prefer the in-place version in step loops.
+  TState Integrate(const TSystem& system,
+                   const TState& state,
+                   double start_time,
+                   float dt) const {
+    TState next_state = state;
+    IntegratorWorkspace<TState> workspace;
+    Integrate(system, next_state, start_time, dt, workspace);
+    return next_state;
+  }
+};
+
+// Step loop with no virtual calls when TIntegrator and TSystem are concrete
+// (final) types, so the derivative kernels can be inlined into the stage
+// updates. TIntegrator needs a non-virtual Step() with the signature of
+// Integrate().
+template <class TIntegrator, class TSystem, class TState>
+void IntegrateSteps(const TIntegrator& integrator,
+                    const TSystem& system,
+                    TState& state,
+                    double start_time,
+                    float dt,
+                    int num_steps,
+                    IntegratorWorkspace<TState>& workspace) {
+  for (int step = 0; step < num_steps; step++) {
+    integrator.Step(system, state, start_time + step * static_cast<double>(dt),
+                    dt, workspace);
+    double end_time = start_time + (step + 1) * static_cast<double>(dt);
+    // Placing anchors edits the state behind the integrator's back.
+    if (system.UpdateKinematicParticles(state, end_time)) {
+      workspace.Invalidate();
+    }
+  }
+}
+
+// Implements the virtual interface on top of TDerived::Step(), which the
+// concrete integrators define (CRTP).
+template <class TDerived, class TSystem, class TState>
+class StaticIntegratorBase : public IntegratorBase<TSystem, TState> {
+ public:
+  using IntegratorBase<TSystem, TState>::Integrate;
+
+  void Integrate(const TSystem& system,
+                 TState& state,
+                 double start_time,
+                 float dt,
+                 IntegratorWorkspace<TState>& workspace) const override {
+    Self().Step(system, state, start_time, dt, workspace);
+  }
+
+  void IntegrateSteps(const TSystem& system,
+                      TState& state,
+                      double start_time,
+                      float dt,
+                      int num_steps,
+                      IntegratorWorkspace<TState>& workspace) const override {
+    GLOO::IntegrateSteps(Self(), system, state, start_time, dt, num_steps,
+                         workspace);
+  }
+
+ private:
+  const TDerived& Self() const {
+    return static_cast<const TDerived&>(*this);
+  }
 };
 }  // namespace GLOO
 
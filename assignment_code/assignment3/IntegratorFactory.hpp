@@ -3,14 +3,17 @@
 
 #include "IntegratorBase.hpp"
 
+#include <memory>
 #include <stdexcept>
 
-#include "gloo/utils.hpp"
-
 #include "IntegratorType.hpp"
 #include "ForwardEulerIntegrator.hpp"
 #include "TrapezoidalIntegrator.hpp"
 #include "RK4Integrator.hpp"
+#include "ImplicitEulerIntegrator.hpp"
+#include "DormandPrinceIntegrator.hpp"
+#include "SymplecticEulerIntegrator.hpp"
+#include "VelocityVerletIntegrator.hpp"
 
 namespace GLOO {
 class IntegratorFactory {
@@ -20,15 +23,31 @@ class IntegratorFactory {
       IntegratorType type) {
     switch (type) {
       case IntegratorType::Euler:
-        return make_unique<ForwardEulerIntegrator<TSystem, TState>>();
+        return Make<ForwardEulerIntegrator<TSystem, TState>>();
       case IntegratorType::Trapezoidal:
-        return make_unique<TrapezoidalIntegrator<TSystem, TState>>();
+        return Make<TrapezoidalIntegrator<TSystem, TState>>();
       case IntegratorType::RK4:
-        return make_unique<RK4Integrator<TSystem, TState>>();
+        return Make<RK4Integrator<TSystem, TState>>();
+      case IntegratorType::ImplicitEuler:
+        return Make<ImplicitEulerIntegrator<TSystem, TState>>();
+      case IntegratorType::DormandPrince:
+        return Make<DormandPrinceIntegrator<TSystem, TState>>();
+      case IntegratorType::SymplecticEuler:
+        return Make<SymplecticEulerIntegrator<TSystem, TState>>();
+      case IntegratorType::VelocityVerlet:
+        return Make<VelocityVerletIntegrator<TSystem, TState>>();
       default:
         throw std::runtime_error("Unrecognized integrator type!");
     }
   }
+
+ private:
+  // Plain new instead of gloo's make_unique, so the simulation code does not
+  // depend on the OpenGL headers.
+  template <class TIntegrator>
+  static std::unique_ptr<TIntegrator> Make() {
+    return std::unique_ptr<TIntegrator>(new TIntegrator());
+  }
 };
 }  // namespace GLOO
 
@@ -1,8 +1,70 @@
 #ifndef INTEGRATOR_TYPE_H_
 #define INTEGRATOR_TYPE_H_
 
+#include <stdexcept>
+#include <string>
+
 namespace GLOO {
-enum class IntegratorType { Euler, Trapezoidal, RK4 };
+enum class IntegratorType {
+  Euler,
+  Trapezoidal,
+  RK4,
+  ImplicitEuler,
+  DormandPrince,
+  SymplecticEuler,
+  VelocityVerlet
+};
+
+// The command line letter of each integrator: e, t, r, i, d, s or v.
+inline IntegratorType ParseIntegratorType(char letter) {
+  switch (letter) {
+    case 'e':
+      return IntegratorType::Euler;
+    case 't':
+      return IntegratorType::Trapezoidal;
+    case 'r':
+      return IntegratorType::RK4;
+    case 'i':
+      return IntegratorType::ImplicitEuler;
+    case 'd':
+      return IntegratorType::DormandPrince;
+    case 's':
+      return IntegratorType::SymplecticEuler;
+    case 'v':
+      return IntegratorType::VelocityVerlet;
+    default:
+      throw std::runtime_error(
+          "Unrecognized integrator type: " + std::string(1, letter) + ".");
+  }
 }
 
+// Name of each integrator in benchmark and test output.
+inline const char* GetIntegratorName(IntegratorType type) {
+  switch (type) {
+    case IntegratorType::Euler:
+      return "euler";
+    case IntegratorType::Trapezoidal:
+      return "trapezoidal";
+    case IntegratorType::RK4:
+      return "rk4";
+    case IntegratorType::ImplicitEuler:
+      return "implicit_euler";
+    case IntegratorType::DormandPrince:
+      return "dormand_prince";
+    case IntegratorType::SymplecticEuler:
+      return "symplectic_euler";
+    case IntegratorType::VelocityVerlet:
+      return "velocity_verlet";
+  }
+  return "unknown";
+}
+
+// Every integrator, in declaration order.
+const IntegratorType kIntegratorTypes[] = {
+    IntegratorType::Euler,           IntegratorType::Trapezoidal,
+    IntegratorType::RK4,             IntegratorType::ImplicitEuler,
+    IntegratorType::DormandPrince,   IntegratorType::SymplecticEuler,
+    IntegratorType::VelocityVerlet};
+}  // namespace GLOO
+
 #endif
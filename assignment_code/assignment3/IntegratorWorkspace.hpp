@@ -0,0 +1,43 @@
+#ifndef INTEGRATOR_WORKSPACE_H_
+#define INTEGRATOR_WORKSPACE_H_
+
+#include <deque>
+
+#include "ConjugateGradient.hpp"
+
+namespace GLOO {
+// Scratch states reused from one step to the next. Each node owns one
+// workspace; once its buffers have grown to the size of the system, stepping
+// does not touch the heap.
+template <class TState>
+struct IntegratorWorkspace {
+  // Derivative stages (k1, k2, ... for Runge-Kutta methods). A deque keeps
+  // references to earlier stages valid while later ones are being added.
+  std::deque<TState> stages;
+  // Intermediate state fed to the next derivative evaluation.
+  TState temp;
+  // Linear system and solver vectors for implicit methods.
+  LinearSolveWorkspace linear_solve;
+
+  // Adaptive methods: the step size to try next (0 means try the whole
+  // interval). First-same-as-last methods: whether stages[0] already holds
+  // the derivative at the current state.
+  float adaptive_step = 0.0f;
+  bool first_same_as_last = false;
+
+  // Drops derivatives carried over from the previous step. Call this when
+  // the state is changed outside the integrator, e.g. on reset.
+  void Invalidate() {
+    first_same_as_last = false;
+  }
+
+  TState& Stage(size_t i) {
+    if (stages.size() <= i) {
+      stages.resize(i + 1);
+    }
+    return stages[i];
+  }
+};
+}  // namespace GLOO
+
+#endif
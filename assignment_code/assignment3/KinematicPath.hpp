@@ -0,0 +1,79 @@
+#ifndef KINEMATIC_PATH_H_
+#define KINEMATIC_PATH_H_
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace GLOO {
+struct Keyframe {
+  double time;
+  glm::vec3 position;
+};
+
+// Scripted motion of a kinematic particle: either a user callback giving the
+// position at a time, or a piecewise linear curve through keyframes that
+// holds its first and last positions outside the keyed range.
+class KinematicPath {
+ public:
+  explicit KinematicPath(std::function<glm::vec3(double)> callback)
+      : callback_(std::move(callback)) {
+  }
+
+  // |keyframes| must be sorted by time.
+  explicit KinematicPath(std::vector<Keyframe> keyframes)
+      : keyframes_(std::move(keyframes)) {
+    if (keyframes_.empty()) {
+      throw std::runtime_error("Kinematic path needs at least one keyframe!");
+    }
+  }
+
+  glm::vec3 GetPosition(double time) const {
+    if (callback_) {
+      return callback_(time);
+    }
+    size_t k = Segment(time);
+    if (k + 1 == keyframes_.size()) {
+      return keyframes_[k].position;
+    }
+    const Keyframe& a = keyframes_[k];
+    const Keyframe& b = keyframes_[k + 1];
+    double u = (time - a.time) / (b.time - a.time);
+    u = std::min(1.0, std::max(0.0, u));
+    return glm::mix(a.position, b.position, static_cast<float>(u));
+  }
+
+  // Exact for keyframes; callbacks are differentiated numerically.
+  glm::vec3 GetVelocity(double time) const {
+    if (callback_) {
+      const double h = 1e-4;
+      return (callback_(time + h) - callback_(time - h)) *
+             static_cast<float>(0.5 / h);
+    }
+    size_t k = Segment(time);
+    if (k + 1 == keyframes_.size() || time < keyframes_[k].time) {
+      return glm::vec3(0.0f);
+    }
+    const Keyframe& a = keyframes_[k];
+    const Keyframe& b = keyframes_[k + 1];
+    return (b.position - a.position) / static_cast<float>(b.time - a.time);
+  }
+
+ private:
+  // Index of the last keyframe at or before |time| (0 if none).
+  size_t Segment(double time) const {
+    auto it = std::upper_bound(
+        keyframes_.begin(), keyframes_.end(), time,
+        [](double t, const Keyframe& keyframe) { return t < keyframe.time; });
+    return it == keyframes_.begin() ? 0 : (it - keyframes_.begin()) - 1;
+  }
+
+  std::function<glm::vec3(double)> callback_;
+  std::vector<Keyframe> keyframes_;
+};
+}  // namespace GLOO
+
+#endif
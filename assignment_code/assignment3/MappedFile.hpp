@@ -0,0 +1,178 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace GLOO {
+// A whole file mapped into memory, either created read-write with a fixed
+// size or opened read-only. The mapping lives as long as the object.
+class MappedFile {
+ public:
+  // Creates (or overwrites) |path| with |size| bytes, reserved on disk up
+  // front where the platform allows, and maps it read-write.
+  MappedFile(const std::string& path, size_t size) : size_(size) {
+    if (size == 0) {
+      throw std::runtime_error("Cannot map an empty file: " + path);
+    }
+    Map(path, true);
+  }
+
+  // Maps an existing file read-only.
+  explicit MappedFile(const std::string& path) : size_(0) {
+    Map(path, false);
+  }
+
+  ~MappedFile() {
+    Close();
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  char* GetData() {
+    return static_cast<char*>(data_);
+  }
+  const char* GetData() const {
+    return static_cast<const char*>(data_);
+  }
+  size_t GetSize() const {
+    return size_;
+  }
+  bool IsOpen() const {
+    return data_ != nullptr;
+  }
+
+  // Unmaps the file. Writable files are flushed and cut to |final_size|
+  // bytes if it is smaller than the mapped size.
+  void Close(size_t final_size = static_cast<size_t>(-1)) {
+    if (data_ == nullptr) {
+      return;
+    }
+    bool shrink = writable_ && final_size < size_;
+#if defined(_WIN32)
+    if (writable_) {
+      FlushViewOfFile(data_, 0);
+    }
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    if (shrink) {
+      LARGE_INTEGER offset;
+      offset.QuadPart = static_cast<LONGLONG>(final_size);
+      SetFilePointerEx(file_, offset, nullptr, FILE_BEGIN);
+      SetEndOfFile(file_);
+    }
+    CloseHandle(file_);
+#else
+    if (writable_) {
+      msync(data_, size_, MS_SYNC);
+    }
+    munmap(data_, size_);
+    if (shrink && ftruncate(file_, static_cast<off_t>(final_size)) != 0) {
+      close(file_);
+      data_ = nullptr;
+      throw std::runtime_error("Cannot truncate mapped file!");
+    }
+    close(file_);
+#endif
+    data_ = nullptr;
+  }
+
+ private:
+#if defined(_WIN32)
+  void Map(const std::string& path, bool writable) {
+    writable_ = writable;
+    file_ = CreateFileA(path.c_str(),
+                        writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                        FILE_SHARE_READ, nullptr,
+                        writable ? CREATE_ALWAYS : OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error("Cannot open file: " + path);
+    }
+    if (!writable) {
+      LARGE_INTEGER file_size;
+      GetFileSizeEx(file_, &file_size);
+      size_ = static_cast<size_t>(file_size.QuadPart);
+    }
+    // CreateFileMapping grows a writable file to the mapping size.
+    ULONGLONG size = size_;
+    mapping_ = size_ == 0 ? nullptr
+                          : CreateFileMappingA(
+                                file_, nullptr,
+                                writable ? PAGE_READWRITE : PAGE_READONLY,
+                                static_cast<DWORD>(size >> 32),
+                                static_cast<DWORD>(size), nullptr);
+    if (mapping_ == nullptr) {
+      CloseHandle(file_);
+      throw std::runtime_error("Cannot map file: " + path);
+    }
+    data_ = MapViewOfFile(mapping_,
+                          writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    if (data_ == nullptr) {
+      CloseHandle(mapping_);
+      CloseHandle(file_);
+      throw std::runtime_error("Cannot map file: " + path);
+    }
+  }
+
+  HANDLE file_;
+  HANDLE mapping_;
+#else
+  void Map(const std::string& path, bool writable) {
+    writable_ = writable;
+    file_ = writable ? open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)
+                     : open(path.c_str(), O_RDONLY);
+    if (file_ < 0) {
+      throw std::runtime_error("Cannot open file: " + path);
+    }
+    bool ok = true;
+    if (writable) {
+      // Reserve the blocks now, so running out of disk fails here instead
+      // of as a bus error on a later write to the mapping.
+#if defined(__linux__)
+      ok = posix_fallocate(file_, 0, static_cast<off_t>(size_)) == 0;
+#else
+      ok = ftruncate(file_, static_cast<off_t>(size_)) == 0;
+#endif
+    } else {
+      struct stat info;
+      ok = fstat(file_, &info) == 0 && info.st_size > 0;
+      size_ = ok ? static_cast<size_t>(info.st_size) : 0;
+    }
+    data_ = ok ? mmap(nullptr, size_,
+                      writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                      MAP_SHARED, file_, 0)
+               : MAP_FAILED;
+    if (data_ == MAP_FAILED) {
+      data_ = nullptr;
+      close(file_);
+      throw std::runtime_error("Cannot map file: " + path);
+    }
+  }
+
+  int file_;
+#endif
+  void* data_ = nullptr;
+  size_t size_;
+  bool writable_ = false;
+};
+}  // namespace GLOO
+
+#endif
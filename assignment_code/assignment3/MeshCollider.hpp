@@ -0,0 +1,185 @@
+#ifndef MESH_COLLIDER_H_
+#define MESH_COLLIDER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Collider.hpp"
+#include "TriangleBvh.hpp"
+
+namespace GLOO {
+// A static triangle mesh, such as a prop loaded from an OBJ file. The BVH is
+// built once; each contact query is a closest-point search bounded by the
+// margin plus the deepest penetration that is resolved.
+//
+// Whether a point is inside is decided by the angle-weighted pseudo-normal of
+// the closest feature (Baerentzen and Aanaes), which gives the right sign on
+// faces, edges and vertices of a closed, consistently wound mesh. Points
+// deeper than |max_depth| are treated as outside, so open meshes and thin
+// shells only push out particles that just crossed them.
+class MeshCollider : public Collider {
+ public:
+  // |indices| holds three vertex indices per counterclockwise triangle.
+  MeshCollider(const std::vector<glm::vec3>& positions,
+               const std::vector<unsigned int>& indices,
+               float max_depth = 0.1f)
+      : bvh_(positions, indices), max_depth_(max_depth) {
+    ComputePseudoNormals(positions, indices);
+  }
+
+  MeshCollider(const std::vector<glm::vec3>& positions,
+               const std::vector<unsigned int>& indices,
+               float max_depth,
+               KinematicPath path)
+      : Collider(std::move(path)),
+        bvh_(positions, indices),
+        max_depth_(max_depth) {
+    ComputePseudoNormals(positions, indices);
+  }
+
+  const TriangleBvh& GetBvh() const {
+    return bvh_;
+  }
+
+  // Angle-weighted unit normal per vertex, also usable for rendering.
+  const std::vector<glm::vec3>& GetVertexNormals() const {
+    return vertex_normals_;
+  }
+
+  void GetLocalBounds(glm::vec3& lo, glm::vec3& hi) const override {
+    bvh_.GetBounds(lo, hi);
+  }
+
+  bool FindContact(const glm::vec3& point,
+                   float margin,
+                   Contact& contact) const override {
+    ClosestTriangleHit hit;
+    bool inside;
+    if (!FindClosest(point, margin + max_depth_, hit, inside)) {
+      return false;
+    }
+    float distance = std::sqrt(hit.distance_squared);
+    if (!inside && distance >= margin) {
+      return false;
+    }
+    glm::vec3 d = point - hit.point;
+    if (distance > 1e-6f) {
+      contact.normal = (inside ? -d : d) / distance;
+    } else {
+      contact.normal = glm::normalize(GetPseudoNormal(hit));
+    }
+    contact.position = hit.point + margin * contact.normal;
+    return true;
+  }
+
+  // Distance from local |point| to the surface, negative inside, if it is
+  // closer than |max_distance|.
+  bool FindSignedDistance(const glm::vec3& point,
+                          float max_distance,
+                          float& distance) const {
+    ClosestTriangleHit hit;
+    bool inside;
+    if (!FindClosest(point, max_distance, hit, inside)) {
+      return false;
+    }
+    distance = std::sqrt(hit.distance_squared);
+    if (inside) {
+      distance = -distance;
+    }
+    return true;
+  }
+
+ private:
+  bool FindClosest(const glm::vec3& point,
+                   float max_distance,
+                   ClosestTriangleHit& hit,
+                   bool& inside) const {
+    if (!bvh_.FindClosest(point, max_distance, hit)) {
+      return false;
+    }
+    inside = glm::dot(point - hit.point, GetPseudoNormal(hit)) < 0.0f;
+    return true;
+  }
+
+  glm::vec3 GetPseudoNormal(const ClosestTriangleHit& hit) const {
+    const unsigned int* triangle = &indices_[3 * hit.triangle];
+    switch (hit.feature) {
+      case TriangleFeature::Vertex0:
+        return vertex_normals_[triangle[0]];
+      case TriangleFeature::Vertex1:
+        return vertex_normals_[triangle[1]];
+      case TriangleFeature::Vertex2:
+        return vertex_normals_[triangle[2]];
+      case TriangleFeature::Edge01:
+        return edge_normals_[3 * hit.triangle];
+      case TriangleFeature::Edge12:
+        return edge_normals_[3 * hit.triangle + 1];
+      case TriangleFeature::Edge20:
+        return edge_normals_[3 * hit.triangle + 2];
+      default:
+        return face_normals_[hit.triangle];
+    }
+  }
+
+  void ComputePseudoNormals(const std::vector<glm::vec3>& positions,
+                            const std::vector<unsigned int>& indices) {
+    indices_ = indices;
+    size_t num_triangles = indices.size() / 3;
+    face_normals_.resize(num_triangles);
+    vertex_normals_.assign(positions.size(), glm::vec3(0.0f));
+    // Sum of the normals of the faces sharing each undirected edge.
+    std::unordered_map<uint64_t, glm::vec3> edge_sums;
+    edge_sums.reserve(3 * num_triangles / 2);
+    for (size_t t = 0; t < num_triangles; t++) {
+      const unsigned int* v = &indices[3 * t];
+      glm::vec3 normal = glm::cross(positions[v[1]] - positions[v[0]],
+                                    positions[v[2]] - positions[v[0]]);
+      float length = glm::length(normal);
+      normal = length > 0.0f ? normal / length : glm::vec3(0.0f);
+      face_normals_[t] = normal;
+      for (int k = 0; k < 3; k++) {
+        // Vertices are weighted by the angle of the triangle there.
+        glm::vec3 e1 = positions[v[(k + 1) % 3]] - positions[v[k]];
+        glm::vec3 e2 = positions[v[(k + 2) % 3]] - positions[v[k]];
+        float lengths = glm::length(e1) * glm::length(e2);
+        if (lengths > 0.0f) {
+          float cosine = glm::dot(e1, e2) / lengths;
+          vertex_normals_[v[k]] +=
+              std::acos(std::min(1.0f, std::max(-1.0f, cosine))) * normal;
+        }
+        edge_sums[EdgeKey(v[k], v[(k + 1) % 3])] += normal;
+      }
+    }
+    for (glm::vec3& normal : vertex_normals_) {
+      float length = glm::length(normal);
+      if (length > 0.0f) {
+        normal /= length;
+      }
+    }
+    edge_normals_.resize(3 * num_triangles);
+    for (size_t t = 0; t < num_triangles; t++) {
+      const unsigned int* v = &indices[3 * t];
+      for (int k = 0; k < 3; k++) {
+        edge_normals_[3 * t + k] = edge_sums[EdgeKey(v[k], v[(k + 1) % 3])];
+      }
+    }
+  }
+
+  static uint64_t EdgeKey(unsigned int a, unsigned int b) {
+    return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+  }
+
+  TriangleBvh bvh_;
+  float max_depth_;
+  std::vector<unsigned int> indices_;
+  std::vector<glm::vec3> face_normals_;
+  // Edges k of triangle t, from corner k to corner k + 1, at 3 * t + k.
+  std::vector<glm::vec3> edge_normals_;
+  std::vector<glm::vec3> vertex_normals_;
+};
+}  // namespace GLOO
+
+#endif
@@ -3,55 +3,284 @@
 
 #include <vector>
 #include <stdexcept>
+#include <type_traits>
 
 #include <glm/glm.hpp>
 
+#include "SimdKernels.hpp"
+
 namespace GLOO {
-struct ParticleState {
-  // The state of a particle system: positions and velocities.
-  std::vector<glm::vec3> positions;
-  std::vector<glm::vec3> velocities;
+// The arithmetic below treats each vector as a flat array of 3N scalars.
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float),
+              "glm::vec3 must be tightly packed.");
+static_assert(sizeof(glm::dvec3) == 3 * sizeof(double),
+              "glm::dvec3 must be tightly packed.");
+
+template <class T>
+struct ParticleStateT;
+
+// Lazy state algebra. Sums and scalings of states build a small expression
+// tree instead of temporaries; assigning the tree to a ParticleState
+// evaluates the whole combination in a single pass over memory, e.g.
+//   state = state + (k1 + k2 * 2.0f + k3 * 2.0f + k4) * (dt / 6.0f);
+// Expressions reference their operands, so do not store them in `auto`
+// variables that outlive the states they were built from.
+namespace state_expr {
+template <class E>
+struct Expr {
+  const E& Self() const {
+    return static_cast<const E&>(*this);
+  }
+};
+
+inline void CheckSize(size_t lhs, size_t rhs) {
+  if (lhs != rhs) {
+    throw std::runtime_error(
+        "Cannot add particle states with inconsistent sizes!");
+  }
+}
+
+template <class T>
+struct Leaf : Expr<Leaf<T>> {
+  typedef T Scalar;
+
+  explicit Leaf(const ParticleStateT<T>& state);
 
-  ParticleState& operator+=(const ParticleState& rhs) {
+  size_t Size() const {
+    return size;
+  }
+  T Position(size_t j) const {
+    return positions[j];
+  }
+  T Velocity(size_t j) const {
+    return velocities[j];
+  }
+
+  const T* positions;
+  const T* velocities;
+  size_t size;
+};
+
+template <class L, class R>
+struct Sum : Expr<Sum<L, R>> {
+  typedef typename L::Scalar Scalar;
+  static_assert(std::is_same<Scalar, typename R::Scalar>::value,
+                "Cannot add particle states of different precision.");
+
+  Sum(const L& l, const R& r) : lhs(l), rhs(r) {
+  }
+
+  size_t Size() const {
+    size_t size = lhs.Size();
+    CheckSize(size, rhs.Size());
+    return size;
+  }
+  Scalar Position(size_t j) const {
+    return lhs.Position(j) + rhs.Position(j);
+  }
+  Scalar Velocity(size_t j) const {
+    return lhs.Velocity(j) + rhs.Velocity(j);
+  }
+
+  L lhs;
+  R rhs;
+};
+
+template <class E>
+struct Scaled : Expr<Scaled<E>> {
+  typedef typename E::Scalar Scalar;
+
+  Scaled(const E& e, Scalar s) : expr(e), k(s) {
+  }
+
+  size_t Size() const {
+    return expr.Size();
+  }
+  Scalar Position(size_t j) const {
+    return k * expr.Position(j);
+  }
+  Scalar Velocity(size_t j) const {
+    return k * expr.Velocity(j);
+  }
+
+  E expr;
+  Scalar k;
+};
+}  // namespace state_expr
+
+// The state of a particle system: positions and velocities, stored with
+// scalar type T (float or double).
+template <class T>
+struct ParticleStateT {
+  typedef T Scalar;
+  typedef glm::vec<3, T, glm::defaultp> Vec3;
+
+  std::vector<Vec3> positions;
+  std::vector<Vec3> velocities;
+
+  ParticleStateT() {
+  }
+
+  // Converts from a state of another precision.
+  template <class U>
+  explicit ParticleStateT(const ParticleStateT<U>& other)
+      : positions(other.positions.begin(), other.positions.end()),
+        velocities(other.velocities.begin(), other.velocities.end()) {
+  }
+
+  // Implicit so that expressions can be passed wherever a state is expected.
+  template <class E>
+  ParticleStateT(const state_expr::Expr<E>& expr) {
+    Assign(expr.Self());
+  }
+
+  template <class E>
+  ParticleStateT& operator=(const state_expr::Expr<E>& expr) {
+    Assign(expr.Self());
+    return *this;
+  }
+
+  template <class E>
+  ParticleStateT& operator+=(const state_expr::Expr<E>& expr) {
+    const E& e = expr.Self();
+    state_expr::CheckSize(FlatSize(), e.Size());
+    T* p = FlatPositions();
+    T* v = FlatVelocities();
+    size_t n = FlatSize();
+    for (size_t j = 0; j < n; j++) {
+      p[j] += e.Position(j);
+    }
+    for (size_t j = 0; j < n; j++) {
+      v[j] += e.Velocity(j);
+    }
+    return *this;
+  }
+
+  ParticleStateT& operator+=(const ParticleStateT& rhs) {
+    CheckSizes(rhs);
+    simd::Add(FlatPositions(), rhs.FlatPositions(), FlatSize());
+    simd::Add(FlatVelocities(), rhs.FlatVelocities(), FlatSize());
+    return *this;
+  }
+
+  ParticleStateT& operator*=(T k) {
+    simd::Scale(FlatPositions(), k, FlatSize());
+    simd::Scale(FlatVelocities(), k, FlatSize());
+    return *this;
+  }
+
+  // Fused *this += k * rhs, without materializing k * rhs.
+  ParticleStateT& AddScaled(const ParticleStateT& rhs, T k) {
+    CheckSizes(rhs);
+    simd::Axpy(FlatPositions(), k, rhs.FlatPositions(), FlatSize());
+    simd::Axpy(FlatVelocities(), k, rhs.FlatVelocities(), FlatSize());
+    return *this;
+  }
+
+  size_t FlatSize() const {
+    return 3 * positions.size();
+  }
+  T* FlatPositions() {
+    return reinterpret_cast<T*>(positions.data());
+  }
+  const T* FlatPositions() const {
+    return reinterpret_cast<const T*>(positions.data());
+  }
+  T* FlatVelocities() {
+    return reinterpret_cast<T*>(velocities.data());
+  }
+  const T* FlatVelocities() const {
+    return reinterpret_cast<const T*>(velocities.data());
+  }
+
+ private:
+  void CheckSizes(const ParticleStateT& rhs) const {
     if (positions.size() != rhs.positions.size() ||
         velocities.size() != rhs.velocities.size() ||
         positions.size() != rhs.velocities.size()) {
       throw std::runtime_error(
           "Cannot add particle states with inconsistent sizes!");
     }
-
-    for (size_t i = 0; i < positions.size(); i++) {
-      positions[i] += rhs.positions[i];
-      velocities[i] += rhs.velocities[i];
-    }
-    return *this;
   }
 
-  ParticleState& operator*=(float k) {
-    for (size_t i = 0; i < positions.size(); i++) {
-      positions[i] *= k;
-      velocities[i] *= k;
+  // Evaluates |e| element by element. The destination may also appear as an
+  // operand (state = state + ...), which is safe because element j of the
+  // result only reads element j of each operand.
+  template <class E>
+  void Assign(const E& e) {
+    static_assert(std::is_same<T, typename E::Scalar>::value,
+                  "Cannot assign particle states of different precision.");
+    size_t n = e.Size();
+    positions.resize(n / 3);
+    velocities.resize(n / 3);
+    T* p = FlatPositions();
+    T* v = FlatVelocities();
+    for (size_t j = 0; j < n; j++) {
+      p[j] = e.Position(j);
+    }
+    for (size_t j = 0; j < n; j++) {
+      v[j] = e.Velocity(j);
     }
-    return *this;
   }
 };
 
-// Operators, optimized via overloading + std::move.
-inline ParticleState operator+(ParticleState s1, const ParticleState& s2) {
-  s1 += s2;
-  return s1;
+typedef ParticleStateT<float> ParticleState;
+typedef ParticleStateT<double> ParticleStateD;
+
+namespace state_expr {
+template <class T>
+inline Leaf<T>::Leaf(const ParticleStateT<T>& state)
+    : positions(state.FlatPositions()),
+      velocities(state.FlatVelocities()),
+      size(state.FlatSize()) {
+  CheckSize(state.positions.size(), state.velocities.size());
+}
+}  // namespace state_expr
+
+// Operators, evaluated lazily via state_expr. Scale factors convert to the
+// precision of the state, so float step sizes work with double states.
+template <class L, class R>
+inline state_expr::Sum<L, R> operator+(const state_expr::Expr<L>& e1,
+                                       const state_expr::Expr<R>& e2) {
+  return state_expr::Sum<L, R>(e1.Self(), e2.Self());
+}
+template <class T, class R>
+inline state_expr::Sum<state_expr::Leaf<T>, R> operator+(
+    const ParticleStateT<T>& s1, const state_expr::Expr<R>& e2) {
+  return state_expr::Sum<state_expr::Leaf<T>, R>(state_expr::Leaf<T>(s1),
+                                                 e2.Self());
+}
+template <class L, class T>
+inline state_expr::Sum<L, state_expr::Leaf<T>> operator+(
+    const state_expr::Expr<L>& e1, const ParticleStateT<T>& s2) {
+  return state_expr::Sum<L, state_expr::Leaf<T>>(e1.Self(),
+                                                 state_expr::Leaf<T>(s2));
+}
+template <class T>
+inline state_expr::Sum<state_expr::Leaf<T>, state_expr::Leaf<T>> operator+(
+    const ParticleStateT<T>& s1, const ParticleStateT<T>& s2) {
+  return state_expr::Sum<state_expr::Leaf<T>, state_expr::Leaf<T>>(
+      state_expr::Leaf<T>(s1), state_expr::Leaf<T>(s2));
+}
+template <class E>
+inline state_expr::Scaled<E> operator*(const state_expr::Expr<E>& e,
+                                       typename E::Scalar k) {
+  return state_expr::Scaled<E>(e.Self(), k);
 }
-inline ParticleState operator+(const ParticleState& s1, ParticleState&& s2) {
-  s2 += s1;
-  return std::move(s2);
+template <class E>
+inline state_expr::Scaled<E> operator*(typename E::Scalar k,
+                                       const state_expr::Expr<E>& e) {
+  return state_expr::Scaled<E>(e.Self(), k);
 }
-inline ParticleState operator*(ParticleState s1, float k) {
-  s1 *= k;
-  return s1;
+template <class T>
+inline state_expr::Scaled<state_expr::Leaf<T>> operator*(
+    const ParticleStateT<T>& s, typename ParticleStateT<T>::Scalar k) {
+  return state_expr::Scaled<state_expr::Leaf<T>>(state_expr::Leaf<T>(s), k);
 }
-inline ParticleState operator*(float k, ParticleState s1) {
-  s1 *= k;
-  return s1;
+template <class T>
+inline state_expr::Scaled<state_expr::Leaf<T>> operator*(
+    typename ParticleStateT<T>::Scalar k, const ParticleStateT<T>& s) {
+  return state_expr::Scaled<state_expr::Leaf<T>>(state_expr::Leaf<T>(s), k);
 }
 }  // namespace GLOO
 
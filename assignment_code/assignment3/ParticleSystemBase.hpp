@@ -2,16 +2,51 @@
 #define PARTICLE_SYSTEM_BASE_H_
 
 #include "ParticleState.hpp"
+#include "ConjugateGradient.hpp"
 
 namespace GLOO {
-class ParticleSystemBase {
+// A system whose state is stored with scalar type T. Time is passed in double
+// so that it does not lose resolution over long runs.
+template <class T>
+class ParticleSystemBaseT {
  public:
-  virtual ~ParticleSystemBase() {
+  typedef ParticleStateT<T> State;
+
+  virtual ~ParticleSystemBaseT() {
+  }
+
+  // Writes the time derivative of |state| into |derivative|, reusing its
+  // storage when it already has the right size.
+  virtual void ComputeTimeDerivative(const State& state,
+                                     double time,
+                                     State& derivative) const = 0;
+
+  State ComputeTimeDerivative(const State& state, double time) const {
+    State derivative;
+    ComputeTimeDerivative(state, time, derivative);
+    return derivative;
   }
 
-  virtual ParticleState ComputeTimeDerivative(const ParticleState& state,
-                                              float time) const = 0;
+  // Linearizes one backward Euler step of size |dt| into
+  // workspace.matrix * dv = workspace.rhs, where dv is the velocity change
+  // over the step. Returns false if the system does not provide force
+  // Jacobians, in which case implicit integrators fall back to a generic
+  // scheme.
+  virtual bool AssembleImplicitSystem(const State& state,
+                                      double time,
+                                      float dt,
+                                      LinearSolveWorkspace& workspace) const {
+    return false;
+  }
+
+  // Places scripted (kinematic) particles at their positions for |time|.
+  // Returns whether the state may have changed.
+  virtual bool UpdateKinematicParticles(State& state, double time) const {
+    return false;
+  }
 };
+
+typedef ParticleSystemBaseT<float> ParticleSystemBase;
 }  // namespace GLOO
 
 #endif
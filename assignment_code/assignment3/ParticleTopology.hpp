@@ -0,0 +1,35 @@
+#ifndef PARTICLE_TOPOLOGY_H_
+#define PARTICLE_TOPOLOGY_H_
+
+namespace GLOO {
+struct Spring {
+  int particle1_index;
+  int particle2_index;
+  float stiffness;
+  float rest_length;
+
+  Spring(int p1, int p2, float k, float l)
+      : particle1_index(p1), particle2_index(p2), stiffness(k), rest_length(l) {
+  }
+};
+
+// A face of the cloth, which catches the wind.
+struct Triangle {
+  int particle_indices[3];
+
+  Triangle(int a, int b, int c) : particle_indices{a, b, c} {
+  }
+};
+
+struct Particle {
+  float mass;
+  bool fixed;  // particle is not simulated if true
+  int path;    // kinematic path a fixed particle follows, or -1 to stay put
+
+  Particle(float m = 1.0f, bool is_fixed = false)
+      : mass(m), fixed(is_fixed), path(-1) {
+  }
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,325 @@
+#ifndef PENDULUM_ENSEMBLE_H_
+#define PENDULUM_ENSEMBLE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "DragForce.hpp"
+#include "GravityForce.hpp"
+#include "ParticleSystemBase.hpp"
+#include "PendulumSystem.hpp"
+#include "SimdKernels.hpp"
+#include "ThreadPool.hpp"
+
+namespace GLOO {
+// Many independent copies of one mass-spring topology, simulated as a single
+// system. The state holds all instances in structure-of-arrays order with the
+// instance index innermost: scalar c (x, y, z) of particle p in instance m is
+// element (c * N + p) * M + m of the flat position or velocity array, for N
+// particles and M instances. The vec3s of the state are therefore not
+// particles; use Get/SetInstanceState() to convert.
+//
+// Every force loop runs over the instances of one particle or spring, which
+// are contiguous and independent, so it vectorizes and needs no coloring.
+// Integrators that only do flat state arithmetic (all but implicit Euler's
+// linear solve, which falls back to fixed-point iteration here) step the whole
+// ensemble with one call.
+//
+// Springs, masses and fixed particles come from the prototype, as do gravity
+// and drag, from its force modules (zero without them). Stiffness, drag and
+// gravity can be set per instance. Other force modules are not supported.
+class PendulumEnsemble final : public ParticleSystemBase {
+ public:
+  PendulumEnsemble(const PendulumSystem& prototype, int num_instances)
+      : num_particles_(static_cast<int>(prototype.GetNumParticles())),
+        num_instances_(num_instances),
+        springs_(prototype.GetSprings()),
+        particles_(prototype.GetParticles()),
+        drag_(num_instances, GetDragCoefficient(prototype)),
+        gravity_x_(num_instances, GetGravity(prototype).x),
+        gravity_y_(num_instances, GetGravity(prototype).y),
+        gravity_z_(num_instances, GetGravity(prototype).z),
+        dynamic_indices_(prototype.GetDynamicIndices()),
+        kinematic_indices_(prototype.GetKinematicIndices()) {
+    if (num_instances < 1) {
+      throw std::runtime_error("Ensemble needs at least one instance!");
+    }
+    stiffness_.resize(springs_.size() * num_instances_);
+    for (size_t s = 0; s < springs_.size(); s++) {
+      std::fill_n(&stiffness_[s * num_instances_], num_instances_,
+                  springs_[s].stiffness);
+    }
+  }
+
+  int GetNumInstances() const {
+    return num_instances_;
+  }
+
+  int GetNumParticles() const {
+    return num_particles_;
+  }
+
+  // Multiplies the prototype stiffness of every spring of |instance|.
+  void SetStiffnessScale(int instance, float scale) {
+    for (size_t s = 0; s < springs_.size(); s++) {
+      stiffness_[s * num_instances_ + instance] = scale * springs_[s].stiffness;
+    }
+  }
+
+  void SetSpringStiffness(int instance, int spring, float stiffness) {
+    stiffness_[spring * num_instances_ + instance] = stiffness;
+  }
+
+  void SetDragCoefficient(int instance, float drag) {
+    drag_[instance] = drag;
+  }
+
+  void SetGravity(int instance, const glm::vec3& gravity) {
+    gravity_x_[instance] = gravity.x;
+    gravity_y_[instance] = gravity.y;
+    gravity_z_[instance] = gravity.z;
+  }
+
+  // Splits the instances into contiguous chunks, one per thread.
+  void SetThreadPool(std::shared_ptr<ThreadPool> pool) {
+    pool_ = std::move(pool);
+  }
+
+  // A state with every instance starting from |prototype_state|.
+  ParticleState MakeState(const ParticleState& prototype_state) const {
+    ParticleState state;
+    state.positions.resize(num_particles_ * num_instances_);
+    state.velocities.resize(num_particles_ * num_instances_);
+    for (int m = 0; m < num_instances_; m++) {
+      SetInstanceState(state, m, prototype_state);
+    }
+    return state;
+  }
+
+  void SetInstanceState(ParticleState& state,
+                        int instance,
+                        const ParticleState& instance_state) const {
+    float* x = state.FlatPositions();
+    float* v = state.FlatVelocities();
+    for (int p = 0; p < num_particles_; p++) {
+      for (int c = 0; c < 3; c++) {
+        x[Index(c, p, instance)] = instance_state.positions[p][c];
+        v[Index(c, p, instance)] = instance_state.velocities[p][c];
+      }
+    }
+  }
+
+  void GetInstanceState(const ParticleState& state,
+                        int instance,
+                        ParticleState& instance_state) const {
+    const float* x = state.FlatPositions();
+    const float* v = state.FlatVelocities();
+    instance_state.positions.resize(num_particles_);
+    instance_state.velocities.resize(num_particles_);
+    for (int p = 0; p < num_particles_; p++) {
+      for (int c = 0; c < 3; c++) {
+        instance_state.positions[p][c] = x[Index(c, p, instance)];
+        instance_state.velocities[p][c] = v[Index(c, p, instance)];
+      }
+    }
+  }
+
+  using ParticleSystemBase::ComputeTimeDerivative;
+
+  void ComputeTimeDerivative(const ParticleState& state,
+                             double time,
+                             ParticleState& derivative) const override {
+    derivative.positions.resize(state.positions.size());
+    derivative.velocities.resize(state.velocities.size());
+    if (pool_ != nullptr) {
+      pool_->ParallelFor(num_instances_, [&](size_t begin, size_t end) {
+        ComputeInstances(state, derivative, begin, end);
+      });
+    } else {
+      ComputeInstances(state, derivative, 0, num_instances_);
+    }
+  }
+
+  // Kinetic plus gravitational and spring potential energy of one instance.
+  float ComputeEnergy(const ParticleState& state, int instance) const {
+    const float* x = state.FlatPositions();
+    const float* v = state.FlatVelocities();
+    glm::vec3 gravity(gravity_x_[instance], gravity_y_[instance],
+                      gravity_z_[instance]);
+    float energy = 0.0f;
+    for (int p : dynamic_indices_) {
+      glm::vec3 position = Gather(x, p, instance);
+      glm::vec3 velocity = Gather(v, p, instance);
+      float mass = particles_[p].mass;
+      energy += 0.5f * mass * glm::dot(velocity, velocity);
+      energy -= mass * glm::dot(gravity, position);
+    }
+    for (size_t s = 0; s < springs_.size(); s++) {
+      float stretch =
+          glm::length(Gather(x, springs_[s].particle1_index, instance) -
+                      Gather(x, springs_[s].particle2_index, instance)) -
+          springs_[s].rest_length;
+      energy += 0.5f * stiffness_[s * num_instances_ + instance] * stretch *
+                stretch;
+    }
+    return energy;
+  }
+
+ private:
+  static float GetDragCoefficient(const PendulumSystem& system) {
+    const DragForce* drag = system.FindForce<DragForce>();
+    return drag != nullptr ? drag->GetDragCoefficient() : 0.0f;
+  }
+
+  static glm::vec3 GetGravity(const PendulumSystem& system) {
+    const GravityForce* gravity = system.FindForce<GravityForce>();
+    return gravity != nullptr ? gravity->GetGravity() : glm::vec3(0.0f);
+  }
+
+  size_t Index(int component, int particle, int instance) const {
+    return (static_cast<size_t>(component) * num_particles_ + particle) *
+               num_instances_ +
+           instance;
+  }
+
+  glm::vec3 Gather(const float* flat, int particle, int instance) const {
+    return glm::vec3(flat[Index(0, particle, instance)],
+                     flat[Index(1, particle, instance)],
+                     flat[Index(2, particle, instance)]);
+  }
+
+  // Derivative of instances [begin, end). Every inner loop runs over that
+  // range with unit stride.
+  void ComputeInstances(const ParticleState& state,
+                        ParticleState& derivative,
+                        size_t begin,
+                        size_t end) const {
+    const size_t n = num_particles_;
+    const size_t m_count = num_instances_;
+    const float* x = state.FlatPositions();
+    const float* y = x + n * m_count;
+    const float* z = y + n * m_count;
+    const float* vx = state.FlatVelocities();
+    const float* vy = vx + n * m_count;
+    const float* vz = vy + n * m_count;
+    float* dx = derivative.FlatPositions();
+    float* dy = dx + n * m_count;
+    float* dz = dy + n * m_count;
+    // Forces accumulate in the velocity derivative, then become
+    // accelerations.
+    float* fx = derivative.FlatVelocities();
+    float* fy = fx + n * m_count;
+    float* fz = fy + n * m_count;
+    const float* drag = drag_.data();
+    const float* gx = gravity_x_.data();
+    const float* gy = gravity_y_.data();
+    const float* gz = gravity_z_.data();
+
+    for (size_t p = 0; p < n; p++) {
+      const float mass = particles_[p].mass;
+      const size_t row = p * m_count;
+      ExternalForces(mass, vx + row, gx, drag, fx + row, begin, end);
+      ExternalForces(mass, vy + row, gy, drag, fy + row, begin, end);
+      ExternalForces(mass, vz + row, gz, drag, fz + row, begin, end);
+    }
+
+    for (size_t s = 0; s < springs_.size(); s++) {
+      const size_t row_i = springs_[s].particle1_index * m_count;
+      const size_t row_j = springs_[s].particle2_index * m_count;
+      SpringForces(springs_[s].rest_length, &stiffness_[s * m_count],
+                   x + row_i, y + row_i, z + row_i, x + row_j, y + row_j,
+                   z + row_j, fx + row_i, fy + row_i, fz + row_i, fx + row_j,
+                   fy + row_j, fz + row_j, begin, end);
+    }
+
+    for (int p : dynamic_indices_) {
+      const float inverse_mass = 1.0f / particles_[p].mass;
+      const size_t row = p * m_count;
+      std::copy(vx + row + begin, vx + row + end, dx + row + begin);
+      std::copy(vy + row + begin, vy + row + end, dy + row + begin);
+      std::copy(vz + row + begin, vz + row + end, dz + row + begin);
+      simd::Scale(fx + row + begin, inverse_mass, end - begin);
+      simd::Scale(fy + row + begin, inverse_mass, end - begin);
+      simd::Scale(fz + row + begin, inverse_mass, end - begin);
+    }
+    for (int p : kinematic_indices_) {
+      const size_t row = p * m_count;
+      std::fill(dx + row + begin, dx + row + end, 0.0f);
+      std::fill(dy + row + begin, dy + row + end, 0.0f);
+      std::fill(dz + row + begin, dz + row + end, 0.0f);
+      std::fill(fx + row + begin, fx + row + end, 0.0f);
+      std::fill(fy + row + begin, fy + row + end, 0.0f);
+      std::fill(fz + row + begin, fz + row + end, 0.0f);
+    }
+  }
+
+  // One component of gravity and drag for the instances of one particle.
+  static void ExternalForces(float mass,
+                             const float* SIM_RESTRICT v,
+                             const float* SIM_RESTRICT g,
+                             const float* SIM_RESTRICT drag,
+                             float* SIM_RESTRICT f,
+                             size_t begin,
+                             size_t end) {
+    for (size_t m = begin; m < end; m++) {
+      f[m] = mass * g[m] - drag[m] * v[m];
+    }
+  }
+
+  // One spring in every instance. The two endpoints are distinct particles,
+  // so their rows never overlap.
+  static void SpringForces(float rest_length,
+                           const float* SIM_RESTRICT k,
+                           const float* SIM_RESTRICT xi,
+                           const float* SIM_RESTRICT yi,
+                           const float* SIM_RESTRICT zi,
+                           const float* SIM_RESTRICT xj,
+                           const float* SIM_RESTRICT yj,
+                           const float* SIM_RESTRICT zj,
+                           float* SIM_RESTRICT fxi,
+                           float* SIM_RESTRICT fyi,
+                           float* SIM_RESTRICT fzi,
+                           float* SIM_RESTRICT fxj,
+                           float* SIM_RESTRICT fyj,
+                           float* SIM_RESTRICT fzj,
+                           size_t begin,
+                           size_t end) {
+    for (size_t m = begin; m < end; m++) {
+      float ex = xi[m] - xj[m];
+      float ey = yi[m] - yj[m];
+      float ez = zi[m] - zj[m];
+      float length = std::sqrt(ex * ex + ey * ey + ez * ez);
+      // Coincident endpoints give e = 0 and thus no force, without a branch.
+      float scale = -k[m] * (length - rest_length) /
+                    (length > 1e-6f ? length : 1e-6f);
+      fxi[m] += scale * ex;
+      fyi[m] += scale * ey;
+      fzi[m] += scale * ez;
+      fxj[m] -= scale * ex;
+      fyj[m] -= scale * ey;
+      fzj[m] -= scale * ez;
+    }
+  }
+
+  int num_particles_;
+  int num_instances_;
+  std::vector<Spring> springs_;
+  std::vector<Particle> particles_;
+
+  // Per instance, and per spring and instance for stiffness_.
+  std::vector<float> stiffness_;
+  std::vector<float> drag_;
+  std::vector<float> gravity_x_;
+  std::vector<float> gravity_y_;
+  std::vector<float> gravity_z_;
+
+  std::vector<int> dynamic_indices_;
+  std::vector<int> kinematic_indices_;
+  std::shared_ptr<ThreadPool> pool_;
+};
+}  // namespace GLOO
+
+#endif
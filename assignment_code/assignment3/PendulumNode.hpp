@@ -2,9 +2,11 @@
 #define PENDULUM_NODE_H_
 
 #include "gloo/SceneNode.hpp"
+#include "FixedStepScheduler.hpp"
 #include "IntegratorBase.hpp"
 #include "ParticleState.hpp"
 #include "PendulumSystem.hpp"
+#include "RewindBuffer.hpp"
 
 #include "gloo/components/RenderingComponent.hpp"
 #include "gloo/components/ShadingComponent.hpp"
@@ -24,27 +26,54 @@ public:
                 std::shared_ptr<PendulumSystem> system,
                 const ParticleState& initial_state)
         : integration_step_(integration_step),
+          scheduler_(integration_step),
           integrator_(std::move(integrator)),
           system_(system),
           state_(initial_state),
-          time_(0.0f) {
-        
+          previous_positions_(initial_state.positions),
+          initial_state_(initial_state),
+          time_(0.0),
+          step_count_(0),
+          rewind_buffer_(kDefaultRewindBudget),
+          rewinding_(false) {
+        workspace_.adaptive_step = integration_step_;
+        rewind_buffer_.Record(step_count_, time_, state_);
+
         CreateParticleSphere();
         CreateSpringLines();
     }
 
+    // Caps the memory kept for rewinding, dropping the oldest history.
+    void SetRewindBudget(size_t memory_budget) {
+        rewind_buffer_.SetMemoryBudget(memory_budget);
+    }
+
     void Update(double delta_time) override {
         if (InputManager::GetInstance().IsKeyPressed('R')) {
             Reset();
             return;
         }
 
-        float time_remaining = static_cast<float>(delta_time);
-        while (time_remaining > 0.0f) {
-            float step = std::min(time_remaining, integration_step_);
-            state_ = integrator_->Integrate(*system_, state_, time_, step);
-            time_ += step;
-            time_remaining -= step;
+        // Hold 'B' to play the history backwards; the simulation resumes
+        // from the shown frame when the key is released.
+        if (InputManager::GetInstance().IsKeyPressed('B')) {
+            Rewind(delta_time);
+            UpdateParticleSpheres();
+            UpdateSpringLines();
+            return;
+        }
+        if (rewinding_) {
+            ResumeFromRewind();
+        }
+
+        int steps = scheduler_.Advance(delta_time);
+        if (steps > 0) {
+            // One statically dispatched batch for all but the last step,
+            // whose starting positions are kept for blending.
+            AdvanceSteps(steps - 1);
+            previous_positions_ = state_.positions;
+            AdvanceSteps(1);
+            rewind_buffer_.Record(step_count_, time_, state_);
         }
 
         UpdateParticleSpheres();
@@ -52,6 +81,43 @@ public:
     }
 
 private:
+    void AdvanceSteps(int num_steps) {
+        integrator_->IntegrateSteps(*system_, state_, time_, integration_step_,
+                                    num_steps, workspace_);
+        time_ += num_steps * static_cast<double>(integration_step_);
+        step_count_ += num_steps;
+    }
+
+    // Shows the recorded frame delta_time further back. Positions are
+    // decoded approximately; the exact state is rebuilt on resume.
+    void Rewind(double delta_time) {
+        if (rewind_buffer_.IsEmpty()) {
+            return;
+        }
+        if (!rewinding_) {
+            rewinding_ = true;
+            rewind_time_ = time_;
+        }
+        double oldest_time = rewind_buffer_.GetTime(rewind_buffer_.GetFirstFrame());
+        rewind_time_ = std::max(rewind_time_ - delta_time, oldest_time);
+        rewind_frame_ = rewind_buffer_.FindFrame(rewind_time_);
+        rewind_buffer_.DecodePositions(rewind_frame_, state_.positions);
+        previous_positions_ = state_.positions;
+    }
+
+    // Restores the exact state of the rewound frame by re-simulating from its
+    // keyframe, and drops the recorded frames after it.
+    void ResumeFromRewind() {
+        rewinding_ = false;
+        uint64_t target_step = rewind_buffer_.GetStep(rewind_frame_);
+        state_ = rewind_buffer_.GetSnapshot(rewind_frame_, &step_count_, &time_);
+        scheduler_.Reset();
+        workspace_.Invalidate();
+        AdvanceSteps(static_cast<int>(target_step - step_count_));
+        previous_positions_ = state_.positions;
+        rewind_buffer_.Truncate(rewind_frame_ + 1);
+    }
+
     void CreateParticleSphere() {
         size_t num_particles = system_->GetNumParticles();
 
@@ -108,9 +174,15 @@ private:
         AddChild(std::move(spring_node_));
     }
 
+    // Position of particle i blended between the last two simulated states.
+    glm::vec3 RenderPosition(size_t i) const {
+        return glm::mix(previous_positions_[i], state_.positions[i],
+                        scheduler_.GetAlpha());
+    }
+
     void UpdateParticleSpheres() {
         for (size_t i = 0; i < particle_nodes_.size(); i++) {
-            particle_nodes_[i]->GetTransform().SetPosition(state_.positions[i]);
+            particle_nodes_[i]->GetTransform().SetPosition(RenderPosition(i));
         }
     }
 
@@ -119,8 +191,8 @@ private:
         
         const auto& springs = system_->GetSprings();
         for (const auto& spring : springs) {
-            positions->push_back(state_.positions[spring.particle1_index]);
-            positions->push_back(state_.positions[spring.particle2_index]);
+            positions->push_back(RenderPosition(spring.particle1_index));
+            positions->push_back(RenderPosition(spring.particle2_index));
         }
         
         auto* rc = spring_node_ptr_->GetComponentPtr<RenderingComponent>();
@@ -130,19 +202,32 @@ private:
     }
 
     void Reset() {
-        // Reset to initial state (would need to store initial_state_ as member)
-        time_ = 0.0f;
-        // For now, just reset velocities to zero
-        for (auto& vel : state_.velocities) {
-            vel = glm::vec3(0.0f);
-        }
+        time_ = 0.0;
+        step_count_ = 0;
+        state_ = initial_state_;
+        previous_positions_ = state_.positions;
+        scheduler_.Reset();
+        workspace_.Invalidate();
+        rewinding_ = false;
+        rewind_buffer_.Clear();
+        rewind_buffer_.Record(step_count_, time_, state_);
     }
 
     float integration_step_;
+    FixedStepScheduler scheduler_;
     std::unique_ptr<IntegratorBase<PendulumSystem, ParticleState>> integrator_;
     std::shared_ptr<PendulumSystem> system_;
     ParticleState state_;
-    float time_;
+    std::vector<glm::vec3> previous_positions_;
+    IntegratorWorkspace<ParticleState> workspace_;
+    ParticleState initial_state_;
+    double time_;
+    uint64_t step_count_;
+
+    RewindBuffer rewind_buffer_;
+    bool rewinding_;
+    double rewind_time_;
+    uint64_t rewind_frame_;
     
     std::vector<SceneNode*> particle_nodes_;  // Non-owning pointers to particle spheres
     std::unique_ptr<SceneNode> spring_node_;
@@ -1,101 +1,203 @@
 #ifndef PENDULUM_SYSTEM_H_
 #define PENDULUM_SYSTEM_H_
 
+#include "ForceModule.hpp"
+#include "KinematicPath.hpp"
 #include "ParticleSystemBase.hpp"
+#include "ParticleTopology.hpp"
+#include "SpringColoring.hpp"
+#include "ThreadPool.hpp"
+#include <memory>
 #include <vector>
 
 namespace GLOO {
 
-struct Spring {
-    int particle1_index;
-    int particle2_index;
-    float stiffness;
-    float rest_length;
-
-    Spring(int p1, int p2, float k, float l)
-        : particle1_index(p1), particle2_index(p2), stiffness(k), rest_length(l) {}
-};
-
-struct Particle {
-    float mass;
-    bool fixed; // particle doesn't move if true
-
-    Particle(float m = 1.0f, bool is_fixed = false)
-        : mass(m), fixed(is_fixed) {}
-};
-
-class PendulumSystem : public ParticleSystemBase {
+// Particle system with state precision T, whose forces come from the force
+// modules registered with it (see ForceModuleT): the system holds the
+// particles, springs and triangles, and sums the modules in registration
+// order into one force buffer. A cloth needs gravity, drag and a
+// SpringForceT; TForce is the precision scenes give the latter, so
+// PendulumSystemT<double, float> keeps double accumulation with float spring
+// kernels. Material parameters are float for all precisions, as is the
+// implicit linear solve.
+//
+// Fixed particles are kinematic: they stay put or follow a scripted path and
+// are never integrated from forces. The system keeps compacted index lists of
+// dynamic and kinematic particles, so per-particle kernels run over each
+// group without branching on the flag.
+//
+// The class is final, so integrators instantiated on it call its methods
+// without virtual dispatch; modules are dispatched once per evaluation each.
+template <class T, class TForce = T>
+class PendulumSystemT final : public ParticleSystemBaseT<T> {
 public:
-    PendulumSystem()
-        : gravity_(glm::vec3(0.0f, -9.8f, 0.0f)),
-          drag_coefficient_(0.5f) {}
+    typedef ParticleStateT<T> State;
+    typedef typename State::Vec3 Vec3;
+    typedef TForce ForceScalar;
+    typedef ForceModuleT<T> ForceModule;
+
+    PendulumSystemT() : batches_dirty_(true), indices_dirty_(true), topology_version_(0) {}
 
     int AddParticle(float mass, bool fixed = false) {
         particles_.push_back(Particle(mass, fixed));
+        indices_dirty_ = true;
+        topology_version_++;
         return static_cast<int>(particles_.size() - 1);
     }
 
     void AddSpring(int particle1_index, int particle2_index, float stiffness, float rest_length) {
         springs_.push_back(Spring(particle1_index, particle2_index, stiffness, rest_length));
+        batches_dirty_ = true;
+    }
+
+    void AddTriangle(int a, int b, int c) {
+        triangles_.push_back(Triangle(a, b, c));
+        topology_version_++;
     }
 
     void SetParticleFixed(int index, bool fixed) {
         if (index >= 0 && index < static_cast<int>(particles_.size())) {
             particles_[index].fixed = fixed;
+            if (!fixed) {
+                particles_[index].path = -1;
+            }
+            indices_dirty_ = true;
+        }
+    }
+
+    // Fixes the particle and moves it along |path|. Call
+    // UpdateKinematicParticles() after each step to place it exactly.
+    void SetParticleKinematic(int index, KinematicPath path) {
+        if (index >= 0 && index < static_cast<int>(particles_.size())) {
+            particles_[index].fixed = true;
+            particles_[index].path = static_cast<int>(paths_.size());
+            paths_.push_back(std::move(path));
+            indices_dirty_ = true;
+        }
+    }
+
+    // Registers |force|, which is evaluated after those registered before.
+    void AddForce(std::shared_ptr<ForceModule> force) {
+        forces_.push_back(std::move(force));
+    }
+
+    const std::vector<std::shared_ptr<ForceModule>>& GetForces() const {
+        return forces_;
+    }
+
+    // The first registered module of type TModule, or nullptr.
+    template <class TModule>
+    TModule* FindForce() const {
+        for (const auto& force : forces_) {
+            if (TModule* module = dynamic_cast<TModule*>(force.get())) {
+                return module;
+            }
         }
+        return nullptr;
     }
 
-    void SetGravity(const glm::vec3& g) {
-        gravity_ = g;
+    // Sum of the forces of all but the internal modules, for solvers that
+    // enforce the springs themselves.
+    void ComputeExternalForces(const State& state,
+                               double time,
+                               std::vector<Vec3>& forces) const {
+        ForceContext context = GetForceContext();
+        forces.assign(state.positions.size(), Vec3(T(0)));
+        for (const auto& force : forces_) {
+            if (!force->IsInternal()) {
+                force->AccumulateForces(context, state, time, forces);
+            }
+        }
     }
 
-    void SetDragCoefficient(float k) {
-        drag_coefficient_ = k;
+    // Runs the force modules and per-particle passes on |pool|. Results are
+    // identical for any thread count, but may differ in the last bit from
+    // the serial path. Pass nullptr to go back to the serial path.
+    void SetThreadPool(std::shared_ptr<ThreadPool> pool) {
+        pool_ = std::move(pool);
     }
 
-    ParticleState ComputeTimeDerivative(const ParticleState& state, float time) const override {
-        ParticleState derivative;
-        int num_particles = static_cast<int>(state.positions.size());
+    using ParticleSystemBaseT<T>::ComputeTimeDerivative;
+
+    void ComputeTimeDerivative(const State& state,
+                               double time,
+                               State& derivative) const override {
+        size_t num_particles = state.positions.size();
         derivative.positions.resize(num_particles);
         derivative.velocities.resize(num_particles);
-        
-        for (int i = 0; i < num_particles; i++) {
-            if (particles_[i].fixed) {
-                derivative.positions[i] = glm::vec3(0.0f);
-                derivative.velocities[i] = glm::vec3(0.0f);
-            } else {
-                derivative.positions[i] = state.velocities[i];
-                glm::vec3 total_force(0.0f);
-                total_force += particles_[i].mass * gravity_;
-                total_force += -drag_coefficient_ * state.velocities[i];
-
-                for (const auto& spring : springs_) {
-                    int other_index = -1;
-
-                    if (spring.particle1_index == i) {
-                        other_index = spring.particle2_index;
-                    } else if (spring.particle2_index == i) {
-                        other_index = spring.particle1_index;
-                    }
-
-                    if (other_index != -1) {
-                        glm::vec3 d = state.positions[i] - state.positions[other_index];
-                        float length = glm::length(d);
-
-                        if (length > 1e-6f) {
-                            glm::vec3 direction = d / length;
-                            float displacement = length - spring.rest_length;
-                            glm::vec3 spring_force = -spring.stiffness * displacement * direction;
-                            total_force += spring_force;
-                        }
-                    }
-                }
-
-                derivative.velocities[i] = total_force / particles_[i].mass;
-            }
+
+        // Accumulate forces in derivative.velocities, then divide by mass.
+        ForceContext context = GetForceContext();
+        std::vector<Vec3>& forces = derivative.velocities;
+        forces.assign(num_particles, Vec3(T(0)));
+        for (const auto& force : forces_) {
+            force->AccumulateForces(context, state, time, forces);
+        }
+
+        context.ParallelFor(GetDynamicIndices().size(), [&](size_t begin, size_t end) {
+            FinalizeDerivative(state, derivative, begin, end);
+        });
+        FinalizeKinematicDerivative(time, derivative);
+    }
+
+    // Assembles (M - dt * df/dv - dt^2 * df/dx) dv = dt * (f + dt * df/dx * v)
+    // from the forces and implicit terms of the modules. Fixed particles get
+    // identity rows with no couplings and take their path velocity at the
+    // end of the step (or are brought to rest).
+    bool AssembleImplicitSystem(const State& state,
+                                double time,
+                                float dt,
+                                LinearSolveWorkspace& workspace) const override {
+        size_t num_particles = state.positions.size();
+        BlockSparseMatrix& matrix = workspace.matrix;
+        std::vector<glm::vec3>& rhs = workspace.rhs;
+        matrix.Reset(num_particles);
+
+        ForceContext context = GetForceContext();
+        std::vector<Vec3>& forces = implicit_forces_;
+        forces.assign(num_particles, Vec3(T(0)));
+        for (const auto& force : forces_) {
+            force->AccumulateForces(context, state, time, forces);
+        }
+        rhs.resize(num_particles);
+        for (size_t i = 0; i < num_particles; i++) {
+            rhs[i] = glm::vec3(forces[i]);
+        }
+
+        const glm::mat3 identity(1.0f);
+        for (int i : GetDynamicIndices()) {
+            matrix.AddDiagonal(i, particles_[i].mass * identity);
+        }
+        for (int i : GetKinematicIndices()) {
+            matrix.AddDiagonal(i, identity);
+        }
+        for (const auto& force : forces_) {
+            force->AddImplicitTerms(context, state, dt, matrix, rhs);
+        }
+
+        for (int i : GetDynamicIndices()) {
+            rhs[i] *= dt;
+        }
+        for (int i : GetKinematicIndices()) {
+            rhs[i] = PathVelocity(i, time + dt) - glm::vec3(state.velocities[i]);
         }
+        return true;
+    }
 
-        return derivative;
+    // Kinetic plus the potential energy of the modules. Drag makes this
+    // decay over time; with only conservative forces it is conserved by the
+    // exact solution, so its drift measures integrator error.
+    T ComputeEnergy(const State& state) const {
+        T energy = 0;
+        for (int i : GetDynamicIndices()) {
+            T mass = particles_[i].mass;
+            energy += T(0.5) * mass * glm::dot(state.velocities[i], state.velocities[i]);
+        }
+        ForceContext context = GetForceContext();
+        for (const auto& force : forces_) {
+            energy += force->ComputePotentialEnergy(context, state);
+        }
+        return energy;
     }
 
     size_t GetNumParticles() const {
@@ -106,12 +208,123 @@ public:
         return springs_;
     }
 
+    const std::vector<Particle>& GetParticles() const {
+        return particles_;
+    }
+
+    const std::vector<Triangle>& GetTriangles() const {
+        return triangles_;
+    }
+
+    const std::shared_ptr<ThreadPool>& GetThreadPool() const {
+        return pool_;
+    }
+
+    // Places kinematic particles exactly on their paths at |time|, with the
+    // path velocity. Returns whether any particle has a path, i.e. whether
+    // |state| may have changed (callers with cached derivatives must then
+    // invalidate them).
+    bool UpdateKinematicParticles(State& state, double time) const override {
+        bool updated = false;
+        for (int i : GetKinematicIndices()) {
+            int path = particles_[i].path;
+            if (path >= 0) {
+                state.positions[i] = Vec3(paths_[path].GetPosition(time));
+                state.velocities[i] = Vec3(paths_[path].GetVelocity(time));
+                updated = true;
+            }
+        }
+        return updated;
+    }
+
+    // Compacted lists of simulated and fixed particles, in index order;
+    // rebuilt after particles are added or change role.
+    const std::vector<int>& GetDynamicIndices() const {
+        UpdateIndices();
+        return dynamic_indices_;
+    }
+
+    const std::vector<int>& GetKinematicIndices() const {
+        UpdateIndices();
+        return kinematic_indices_;
+    }
+
+    // What the force modules see of the system; the spring batches are
+    // only colored for parallel evaluation.
+    ForceContext GetForceContext() const {
+        return ForceContext(particles_, GetDynamicIndices(), springs_, triangles_,
+                            pool_.get(),
+                            pool_ != nullptr ? &GetSpringBatches() : nullptr,
+                            topology_version_);
+    }
+
+    // Springs grouped into conflict-free batches; rebuilt after AddSpring.
+    const SpringBatches& GetSpringBatches() const {
+        if (batches_dirty_) {
+            spring_batches_ = ColorSprings(static_cast<int>(particles_.size()), springs_);
+            batches_dirty_ = false;
+        }
+        return spring_batches_;
+    }
+
 private:
+    void UpdateIndices() const {
+        if (!indices_dirty_) {
+            return;
+        }
+        dynamic_indices_.clear();
+        kinematic_indices_.clear();
+        for (size_t i = 0; i < particles_.size(); i++) {
+            (particles_[i].fixed ? kinematic_indices_ : dynamic_indices_)
+                .push_back(static_cast<int>(i));
+        }
+        indices_dirty_ = false;
+    }
+
+    glm::vec3 PathVelocity(int index, double time) const {
+        int path = particles_[index].path;
+        return path >= 0 ? paths_[path].GetVelocity(time) : glm::vec3(0.0f);
+    }
+
+    // Turns the accumulated forces in derivative.velocities into
+    // accelerations, for dynamic particles [begin, end) of the compacted list.
+    void FinalizeDerivative(const State& state,
+                            State& derivative,
+                            size_t begin,
+                            size_t end) const {
+        const std::vector<int>& dynamic = dynamic_indices_;
+        for (size_t k = begin; k < end; k++) {
+            int i = dynamic[k];
+            derivative.positions[i] = state.velocities[i];
+            derivative.velocities[i] = derivative.velocities[i] / T(particles_[i].mass);
+        }
+    }
+
+    // Kinematic particles move with their path velocity and ignore forces.
+    void FinalizeKinematicDerivative(double time, State& derivative) const {
+        for (int i : kinematic_indices_) {
+            derivative.positions[i] = Vec3(PathVelocity(i, time));
+            derivative.velocities[i] = Vec3(T(0));
+        }
+    }
+
     std::vector<Particle> particles_;
     std::vector<Spring> springs_;
-    glm::vec3 gravity_;
-    float drag_coefficient_;
+    std::vector<KinematicPath> paths_;
+    std::vector<Triangle> triangles_;
+    std::vector<std::shared_ptr<ForceModule>> forces_;
+
+    std::shared_ptr<ThreadPool> pool_;
+    mutable SpringBatches spring_batches_;
+    mutable bool batches_dirty_;
+    mutable std::vector<int> dynamic_indices_;
+    mutable std::vector<int> kinematic_indices_;
+    mutable bool indices_dirty_;
+    size_t topology_version_;
+    mutable std::vector<Vec3> implicit_forces_;
 };
+
+typedef PendulumSystemT<float> PendulumSystem;
 } // namespace GLOO
 
 #endif
@@ -0,0 +1,59 @@
+#ifndef PRECISION_MODE_H_
+#define PRECISION_MODE_H_
+
+#include <stdexcept>
+#include <string>
+
+#include "PendulumSystem.hpp"
+
+namespace GLOO {
+// Scalar types of a simulation. Mixed stores the state in double and
+// evaluates spring forces in float, see PendulumSystemT.
+enum class PrecisionMode { Float, Double, Mixed };
+
+inline PrecisionMode ParsePrecisionMode(const std::string& name) {
+  if (name == "float") {
+    return PrecisionMode::Float;
+  }
+  if (name == "double") {
+    return PrecisionMode::Double;
+  }
+  if (name == "mixed") {
+    return PrecisionMode::Mixed;
+  }
+  throw std::runtime_error("Unrecognized precision mode: " + name + ".");
+}
+
+inline const char* GetPrecisionModeName(PrecisionMode mode) {
+  switch (mode) {
+    case PrecisionMode::Float:
+      return "float";
+    case PrecisionMode::Double:
+      return "double";
+    case PrecisionMode::Mixed:
+      return "mixed";
+  }
+  return "unknown";
+}
+
+// The mass-spring system type of each mode.
+template <PrecisionMode mode>
+struct PrecisionTraits;
+
+template <>
+struct PrecisionTraits<PrecisionMode::Float> {
+  typedef PendulumSystemT<float> PendulumSystemType;
+};
+
+template <>
+struct PrecisionTraits<PrecisionMode::Double> {
+  typedef PendulumSystemT<double> PendulumSystemType;
+};
+
+template <>
+struct PrecisionTraits<PrecisionMode::Mixed> {
+  typedef PendulumSystemT<double, float> PendulumSystemType;
+};
+}  // namespace GLOO
+
+#endif
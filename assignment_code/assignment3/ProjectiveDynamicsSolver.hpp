@@ -0,0 +1,187 @@
+#ifndef PROJECTIVE_DYNAMICS_SOLVER_H_
+#define PROJECTIVE_DYNAMICS_SOLVER_H_
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "ClothSolverBase.hpp"
+#include "PendulumSystem.hpp"
+#include "SkylineCholesky.hpp"
+
+namespace GLOO {
+// Projective dynamics (Bouaziz et al. 2014) on the topology of a
+// PendulumSystem, with each spring as a rest-length constraint of weight
+// equal to its stiffness. Every iteration alternates
+//   - a local step projecting each spring onto its rest length, which is
+//     independent per spring and runs on the system's thread pool, and
+//   - a global step solving (M / h^2 + L) x = M / h^2 y + sum w A^T p,
+//     whose matrix only depends on the topology and h.
+// The matrix is Cholesky factored once at construction, after the topology
+// is final, so each iteration costs one back-substitution. Stepping with a
+// different h refactors. Fixed particles are eliminated from the global
+// system; changing which particles are fixed requires a new solver. The
+// force modules of the system other than the springs enter the inertial
+// prediction.
+class ProjectiveDynamicsSolver : public ClothSolverBase {
+ public:
+  ProjectiveDynamicsSolver(std::shared_ptr<PendulumSystem> system,
+                           float dt,
+                           int iterations)
+      : system_(std::move(system)), iterations_(iterations) {
+    Factor(dt);
+  }
+
+  void SetIterations(int iterations) {
+    iterations_ = iterations;
+  }
+
+  void Step(ParticleState& state, double time, float dt) override {
+    if (dt != factored_dt_) {
+      Factor(dt);
+    }
+    const std::vector<Particle>& particles = system_->GetParticles();
+    const std::vector<Spring>& springs = system_->GetSprings();
+    system_->ComputeExternalForces(state, time, external_forces_);
+
+    // Inertial prediction y, also the initial guess. Kinematic particles are
+    // moved to where they are at the end of the step first, since the
+    // global step reads their positions.
+    for (int i : system_->GetKinematicIndices()) {
+      state.velocities[i] = glm::vec3(0.0f);
+    }
+    system_->UpdateKinematicParticles(state, time + dt);
+    previous_positions_ = state.positions;
+    inertia_.resize(unknown_particle_.size());
+    for (size_t u = 0; u < unknown_particle_.size(); u++) {
+      int i = unknown_particle_[u];
+      glm::vec3& v = state.velocities[i];
+      v += dt / particles[i].mass * external_forces_[i];
+      state.positions[i] += dt * v;
+      inertia_[u] = glm::dvec3(state.positions[i]) *
+                    static_cast<double>(particles[i].mass / (dt * dt));
+    }
+
+    projections_.resize(springs.size());
+    ThreadPool* pool = system_->GetThreadPool().get();
+    for (int iteration = 0; iteration < iterations_; iteration++) {
+      auto project = [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++) {
+          const Spring& spring = springs[s];
+          glm::vec3 d = state.positions[spring.particle1_index] -
+                        state.positions[spring.particle2_index];
+          float length = glm::length(d);
+          projections_[s] = length > 1e-6f
+                                ? d * (spring.rest_length / length)
+                                : glm::vec3(0.0f);
+        }
+      };
+      if (pool != nullptr) {
+        pool->ParallelFor(springs.size(), project);
+      } else {
+        project(0, springs.size());
+      }
+
+      rhs_ = inertia_;
+      for (size_t s = 0; s < springs.size(); s++) {
+        const Spring& spring = springs[s];
+        int i = spring.particle1_index;
+        int j = spring.particle2_index;
+        int ui = particle_unknown_[i];
+        int uj = particle_unknown_[j];
+        double w = spring.stiffness;
+        glm::dvec3 p(projections_[s]);
+        if (ui >= 0) {
+          rhs_[ui] += w * (uj >= 0 ? p : p + glm::dvec3(state.positions[j]));
+        }
+        if (uj >= 0) {
+          rhs_[uj] -= w * (ui >= 0 ? p : p - glm::dvec3(state.positions[i]));
+        }
+      }
+      cholesky_.Solve(rhs_);
+      for (size_t u = 0; u < unknown_particle_.size(); u++) {
+        state.positions[unknown_particle_[u]] = glm::vec3(rhs_[u]);
+      }
+    }
+
+    float inverse_dt = 1.0f / dt;
+    for (int i : unknown_particle_) {
+      state.velocities[i] =
+          (state.positions[i] - previous_positions_[i]) * inverse_dt;
+    }
+  }
+
+ private:
+  // Numbers the free particles in order, which keeps the cloth grid's band
+  // structure, and factors the global matrix for step size |dt|.
+  void Factor(float dt) {
+    const std::vector<Particle>& particles = system_->GetParticles();
+    const std::vector<Spring>& springs = system_->GetSprings();
+
+    particle_unknown_.assign(particles.size(), -1);
+    unknown_particle_.clear();
+    for (size_t i = 0; i < particles.size(); i++) {
+      if (!particles[i].fixed) {
+        particle_unknown_[i] = static_cast<int>(unknown_particle_.size());
+        unknown_particle_.push_back(static_cast<int>(i));
+      }
+    }
+
+    std::vector<int> first_column(unknown_particle_.size());
+    for (size_t u = 0; u < first_column.size(); u++) {
+      first_column[u] = static_cast<int>(u);
+    }
+    for (const auto& spring : springs) {
+      int ui = particle_unknown_[spring.particle1_index];
+      int uj = particle_unknown_[spring.particle2_index];
+      if (ui >= 0 && uj >= 0) {
+        int row = std::max(ui, uj);
+        first_column[row] = std::min(first_column[row], std::min(ui, uj));
+      }
+    }
+
+    cholesky_.Reset(first_column);
+    for (size_t u = 0; u < unknown_particle_.size(); u++) {
+      double mass = particles[unknown_particle_[u]].mass;
+      cholesky_.Add(static_cast<int>(u), static_cast<int>(u),
+                    mass / (static_cast<double>(dt) * dt));
+    }
+    for (const auto& spring : springs) {
+      int ui = particle_unknown_[spring.particle1_index];
+      int uj = particle_unknown_[spring.particle2_index];
+      double w = spring.stiffness;
+      if (ui >= 0) {
+        cholesky_.Add(ui, ui, w);
+      }
+      if (uj >= 0) {
+        cholesky_.Add(uj, uj, w);
+      }
+      if (ui >= 0 && uj >= 0) {
+        cholesky_.Add(std::max(ui, uj), std::min(ui, uj), -w);
+      }
+    }
+    if (!cholesky_.Factor()) {
+      throw std::runtime_error(
+          "Projective dynamics system matrix is not positive definite!");
+    }
+    factored_dt_ = dt;
+  }
+
+  std::shared_ptr<PendulumSystem> system_;
+  int iterations_;
+
+  float factored_dt_;
+  SkylineCholesky cholesky_;
+  // Maps particles to rows of the global system (-1 for fixed) and back.
+  std::vector<int> particle_unknown_;
+  std::vector<int> unknown_particle_;
+
+  std::vector<glm::vec3> previous_positions_;
+  std::vector<glm::vec3> projections_;
+  std::vector<glm::vec3> external_forces_;
+  std::vector<glm::dvec3> inertia_;
+  std::vector<glm::dvec3> rhs_;
+};
+}  // namespace GLOO
+
+#endif
@@ -5,20 +5,35 @@
 
 namespace GLOO {
 template <class TSystem, class TState>
-class RK4Integrator : public IntegratorBase<TSystem, TState> {
-    TState Integrate(const TSystem& system,
-                    const TState& state,
-                    float start_time,
-                    float dt) const override {
-        // RK4
-        TState k1 = system.ComputeTimeDerivative(state, start_time);
-        TState k2 = system.ComputeTimeDerivative(state + k1 * (dt / 2.0f), start_time + dt / 2.0f);
-        TState k3 = system.ComputeTimeDerivative(state + k2 * (dt / 2.0f), start_time + dt / 2.0f);
-        TState k4 = system.ComputeTimeDerivative(state + k3 * dt, start_time + dt);
+class RK4Integrator
+    : public StaticIntegratorBase<RK4Integrator<TSystem, TState>,
+                                  TSystem, TState> {
+public:
+    void Step(const TSystem& system,
+              TState& state,
+              double start_time,
+              float dt,
+              IntegratorWorkspace<TState>& workspace) const {
+        // RK4, with the weights computed in the precision of the state.
+        typedef typename TState::Scalar Scalar;
+        const Scalar h = dt;
+        TState& k1 = workspace.Stage(0);
+        TState& k2 = workspace.Stage(1);
+        TState& k3 = workspace.Stage(2);
+        TState& k4 = workspace.Stage(3);
+        TState& temp_state = workspace.temp;
 
-        return state + (k1 + k2 * 2.0f + k3 * 2.0f + k4) * (dt / 6.0f);
+        system.ComputeTimeDerivative(state, start_time, k1);
+        temp_state = state + k1 * (h / 2);
+        system.ComputeTimeDerivative(temp_state, start_time + dt / 2.0f, k2);
+        temp_state = state + k2 * (h / 2);
+        system.ComputeTimeDerivative(temp_state, start_time + dt / 2.0f, k3);
+        temp_state = state + k3 * h;
+        system.ComputeTimeDerivative(temp_state, start_time + dt, k4);
+
+        state = state + (k1 + k2 * 2.0f + k3 * 2.0f + k4) * (h / 6);
     }
 };
 } // namespace GLOO
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,280 @@
+#ifndef REWIND_BUFFER_H_
+#define REWIND_BUFFER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+
+#include "ParticleState.hpp"
+
+namespace GLOO {
+// Enough for a few seconds of history of a 256 x 256 cloth at 60 frames per
+// second.
+const size_t kDefaultRewindBudget = 128 * 1024 * 1024;
+
+// Bounded history of a simulation for rewinding. Recorded frames are grouped
+// into segments: the first frame of a segment is an exact snapshot of the
+// state, and each later frame stores only its positions, as 16-bit
+// quantized deltas from the previous frame. The quantizer feeds back its own
+// rounding, so the error stays within half a quantization step per frame
+// instead of accumulating along the segment.
+//
+// Decoded positions are approximate and meant for display while scrubbing.
+// To resume simulating from a frame, restore the snapshot of its segment and
+// re-simulate the steps in between, which reproduces the recorded states.
+//
+// Each segment reserves its full size when it starts. When a new segment
+// would not fit in the memory budget, the oldest segments are dropped, so
+// usage never exceeds the budget. Segments are shortened when two of them
+// would not fit, and recording stops if a single snapshot does not.
+class RewindBuffer {
+ public:
+  explicit RewindBuffer(size_t memory_budget, int keyframe_interval = 32)
+      : memory_budget_(memory_budget),
+        keyframe_interval_(std::max(1, keyframe_interval)),
+        end_frame_(0),
+        used_bytes_(0) {
+  }
+
+  // Frames are numbered from the first Record() after construction or
+  // Clear(); dropped frames keep their numbers.
+  uint64_t GetFirstFrame() const {
+    return segments_.empty() ? end_frame_ : segments_.front().first_frame;
+  }
+  // One past the newest frame.
+  uint64_t GetEndFrame() const {
+    return end_frame_;
+  }
+  bool IsEmpty() const {
+    return segments_.empty();
+  }
+  size_t GetMemoryUsage() const {
+    return used_bytes_;
+  }
+  size_t GetMemoryBudget() const {
+    return memory_budget_;
+  }
+
+  void SetMemoryBudget(size_t memory_budget) {
+    memory_budget_ = memory_budget;
+    while (used_bytes_ > memory_budget_ && !segments_.empty()) {
+      DropOldest();
+    }
+  }
+
+  void Clear() {
+    segments_.clear();
+    reference_.clear();
+    end_frame_ = 0;
+    used_bytes_ = 0;
+  }
+
+  // Appends |state|, reached after |step| steps at simulation time |time|.
+  // Returns false if even a single snapshot exceeds the memory budget.
+  bool Record(uint64_t step, double time, const ParticleState& state) {
+    size_t num_particles = state.positions.size();
+    bool new_segment = segments_.empty() ||
+                       segments_.back().frames.size() ==
+                           segments_.back().capacity ||
+                       num_particles != reference_.size();
+    if (new_segment && !StartSegment(num_particles)) {
+      return false;
+    }
+    Segment& segment = segments_.back();
+    if (new_segment) {
+      segment.snapshot = state;
+      reference_ = state.positions;
+      segment.frames.push_back(FrameInfo{step, time, 0.0f});
+    } else {
+      segment.frames.push_back(
+          FrameInfo{step, time, AppendDelta(state.positions, segment)});
+    }
+    end_frame_++;
+    return true;
+  }
+
+  // The newest frame at or before |time|, clamped to the oldest frame.
+  uint64_t FindFrame(double time) const {
+    if (segments_.empty()) {
+      throw std::runtime_error("Rewind buffer is empty!");
+    }
+    auto segment = std::upper_bound(
+        segments_.begin(), segments_.end(), time,
+        [](double t, const Segment& s) { return t < s.frames[0].time; });
+    if (segment == segments_.begin()) {
+      return segments_.front().first_frame;
+    }
+    --segment;
+    auto frame = std::upper_bound(
+        segment->frames.begin(), segment->frames.end(), time,
+        [](double t, const FrameInfo& f) { return t < f.time; });
+    return segment->first_frame + (frame - segment->frames.begin()) - 1;
+  }
+
+  double GetTime(uint64_t frame) const {
+    const Segment& segment = FindSegment(frame);
+    return segment.frames[frame - segment.first_frame].time;
+  }
+
+  uint64_t GetStep(uint64_t frame) const {
+    const Segment& segment = FindSegment(frame);
+    return segment.frames[frame - segment.first_frame].step;
+  }
+
+  // Approximate positions of |frame|, decoded from its segment's snapshot.
+  void DecodePositions(uint64_t frame,
+                       std::vector<glm::vec3>& positions) const {
+    const Segment& segment = FindSegment(frame);
+    positions = segment.snapshot.positions;
+    float* p = reinterpret_cast<float*>(positions.data());
+    size_t n = 3 * positions.size();
+    for (uint64_t k = 1; k <= frame - segment.first_frame; k++) {
+      ApplyDelta(segment, k, p, n);
+    }
+  }
+
+  // The exact state at the start of |frame|'s segment, and its step and
+  // time. Re-simulate GetStep(frame) - *step steps to reach |frame|.
+  const ParticleState& GetSnapshot(uint64_t frame,
+                                   uint64_t* step,
+                                   double* time) const {
+    const Segment& segment = FindSegment(frame);
+    *step = segment.frames[0].step;
+    *time = segment.frames[0].time;
+    return segment.snapshot;
+  }
+
+  // Drops |frame| and everything after it, e.g. before recording a new
+  // future from a rewound state.
+  void Truncate(uint64_t frame) {
+    while (!segments_.empty() && segments_.back().first_frame >= frame) {
+      used_bytes_ -= segments_.back().bytes;
+      segments_.pop_back();
+    }
+    end_frame_ = std::max(frame, GetFirstFrame());
+    if (segments_.empty()) {
+      reference_.clear();
+      return;
+    }
+    Segment& segment = segments_.back();
+    size_t num_frames = end_frame_ - segment.first_frame;
+    if (num_frames < segment.frames.size()) {
+      segment.frames.resize(num_frames);
+      segment.deltas.resize((num_frames - 1) * 3 * reference_.size());
+    }
+    DecodePositions(end_frame_ - 1, reference_);
+  }
+
+ private:
+  struct FrameInfo {
+    uint64_t step;
+    double time;
+    // Quantization step of the frame's deltas.
+    float scale;
+  };
+
+  struct Segment {
+    uint64_t first_frame;
+    size_t capacity;
+    size_t bytes;
+    ParticleState snapshot;
+    std::vector<FrameInfo> frames;
+    // 3 * num_particles quantized position deltas per frame after the first.
+    std::vector<int16_t> deltas;
+  };
+
+  static size_t SegmentBytes(size_t num_particles, size_t num_frames) {
+    return 2 * num_particles * sizeof(glm::vec3) +
+           num_frames * sizeof(FrameInfo) +
+           (num_frames - 1) * 3 * num_particles * sizeof(int16_t);
+  }
+
+  bool StartSegment(size_t num_particles) {
+    // Keep room for the previous segment while this one fills up, so there
+    // is always at least one full segment to rewind into.
+    size_t capacity = keyframe_interval_;
+    while (capacity > 1 &&
+           2 * SegmentBytes(num_particles, capacity) > memory_budget_) {
+      capacity /= 2;
+    }
+    size_t bytes = SegmentBytes(num_particles, capacity);
+    if (bytes > memory_budget_) {
+      Clear();
+      return false;
+    }
+    while (used_bytes_ + bytes > memory_budget_) {
+      DropOldest();
+    }
+    segments_.emplace_back();
+    Segment& segment = segments_.back();
+    segment.first_frame = end_frame_;
+    segment.capacity = capacity;
+    segment.bytes = bytes;
+    segment.frames.reserve(capacity);
+    segment.deltas.reserve((capacity - 1) * 3 * num_particles);
+    used_bytes_ += bytes;
+    return true;
+  }
+
+  void DropOldest() {
+    used_bytes_ -= segments_.front().bytes;
+    segments_.pop_front();
+  }
+
+  // Quantizes positions - reference_ into the segment and advances
+  // reference_ by the dequantized deltas, exactly as DecodePositions() will.
+  // Returns the quantization step.
+  float AppendDelta(const std::vector<glm::vec3>& positions, Segment& segment) {
+    const float* p = reinterpret_cast<const float*>(positions.data());
+    float* r = reinterpret_cast<float*>(reference_.data());
+    size_t n = 3 * positions.size();
+    float max_delta = 0.0f;
+    for (size_t j = 0; j < n; j++) {
+      max_delta = std::max(max_delta, std::abs(p[j] - r[j]));
+    }
+    float scale = max_delta / 32767.0f;
+    float inverse_scale = scale > 0.0f ? 1.0f / scale : 0.0f;
+    size_t offset = segment.deltas.size();
+    segment.deltas.resize(offset + n);
+    int16_t* q = segment.deltas.data() + offset;
+    for (size_t j = 0; j < n; j++) {
+      float steps = std::round((p[j] - r[j]) * inverse_scale);
+      q[j] = static_cast<int16_t>(std::max(-32767.0f, std::min(32767.0f, steps)));
+      r[j] += q[j] * scale;
+    }
+    return scale;
+  }
+
+  // Adds the deltas of local frame k (>= 1) of |segment| to |p|.
+  static void ApplyDelta(const Segment& segment, uint64_t k, float* p, size_t n) {
+    const int16_t* q = segment.deltas.data() + (k - 1) * n;
+    float scale = segment.frames[k].scale;
+    for (size_t j = 0; j < n; j++) {
+      p[j] += q[j] * scale;
+    }
+  }
+
+  const Segment& FindSegment(uint64_t frame) const {
+    if (frame < GetFirstFrame() || frame >= end_frame_) {
+      throw std::runtime_error("Rewind frame out of range!");
+    }
+    auto segment = std::upper_bound(
+        segments_.begin(), segments_.end(), frame,
+        [](uint64_t f, const Segment& s) { return f < s.first_frame; });
+    return *(segment - 1);
+  }
+
+  size_t memory_budget_;
+  size_t keyframe_interval_;
+  std::deque<Segment> segments_;
+  // Positions of the newest frame as the decoder reconstructs them.
+  std::vector<glm::vec3> reference_;
+  uint64_t end_frame_;
+  size_t used_bytes_;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef SDF_COLLIDER_H_
+#define SDF_COLLIDER_H_
+
+#include "Collider.hpp"
+#include "DistanceGrid.hpp"
+
+namespace GLOO {
+// A static shape given by a baked distance grid. A contact query is one
+// grid lookup, so its cost does not depend on the detail of the mesh the
+// grid was baked from. Points deeper inside than the band of the grid,
+// where the distance is flat, are left alone like those of a MeshCollider
+// deeper than its maximum depth.
+class SdfCollider : public Collider {
+ public:
+  explicit SdfCollider(DistanceGrid grid) : grid_(std::move(grid)) {
+  }
+
+  SdfCollider(DistanceGrid grid, KinematicPath path)
+      : Collider(std::move(path)), grid_(std::move(grid)) {
+  }
+
+  const DistanceGrid& GetGrid() const {
+    return grid_;
+  }
+
+  void GetLocalBounds(glm::vec3& lo, glm::vec3& hi) const override {
+    grid_.GetBounds(lo, hi);
+  }
+
+  bool FindContact(const glm::vec3& point,
+                   float margin,
+                   Contact& contact) const override {
+    float distance;
+    glm::vec3 gradient;
+    if (!grid_.Sample(point, distance, gradient) || distance >= margin) {
+      return false;
+    }
+    float length = glm::length(gradient);
+    if (length < 1e-6f) {
+      return false;
+    }
+    contact.normal = gradient / length;
+    contact.position = point + (margin - distance) * contact.normal;
+    return true;
+  }
+
+ private:
+  DistanceGrid grid_;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,305 @@
+#ifndef SIMD_KERNELS_H_
+#define SIMD_KERNELS_H_
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIM_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIM_SIMD_SSE
+#endif
+
+// Promises the compiler that a pointer does not alias any other pointer
+// argument, so loops over several arrays can be vectorized without runtime
+// overlap checks.
+#if defined(_MSC_VER)
+#define SIM_RESTRICT __restrict
+#else
+#define SIM_RESTRICT __restrict__
+#endif
+
+namespace GLOO {
+// Element-wise kernels over flat float and double arrays. The particle state
+// is stored as tightly packed 3-vectors, so adding or scaling two states is
+// the same element-wise operation over 3N scalars regardless of layout. All
+// loads and stores are unaligned; the scalar tail handles counts that are not
+// a multiple of the vector width.
+namespace simd {
+
+// dst[i] += src[i]
+inline void Add(float* dst, const float* src, size_t n) {
+  size_t i = 0;
+#if defined(SIM_SIMD_AVX)
+  for (; i + 8 <= n; i += 8) {
+    __m256 a = _mm256_loadu_ps(dst + i);
+    __m256 b = _mm256_loadu_ps(src + i);
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(a, b));
+  }
+#elif defined(SIM_SIMD_SSE)
+  for (; i + 4 <= n; i += 4) {
+    __m128 a = _mm_loadu_ps(dst + i);
+    __m128 b = _mm_loadu_ps(src + i);
+    _mm_storeu_ps(dst + i, _mm_add_ps(a, b));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] += src[i];
+  }
+}
+
+// dst[i] *= k
+inline void Scale(float* dst, float k, size_t n) {
+  size_t i = 0;
+#if defined(SIM_SIMD_AVX)
+  __m256 vk = _mm256_set1_ps(k);
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), vk));
+  }
+#elif defined(SIM_SIMD_SSE)
+  __m128 vk = _mm_set1_ps(k);
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), vk));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] *= k;
+  }
+}
+
+// dst[i] += k * src[i]
+inline void Axpy(float* dst, float k, const float* src, size_t n) {
+  size_t i = 0;
+#if defined(SIM_SIMD_AVX)
+  __m256 vk = _mm256_set1_ps(k);
+  for (; i + 8 <= n; i += 8) {
+    __m256 a = _mm256_loadu_ps(dst + i);
+    __m256 b = _mm256_loadu_ps(src + i);
+#if defined(__FMA__)
+    _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(vk, b, a));
+#else
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(a, _mm256_mul_ps(vk, b)));
+#endif
+  }
+#elif defined(SIM_SIMD_SSE)
+  __m128 vk = _mm_set1_ps(k);
+  for (; i + 4 <= n; i += 4) {
+    __m128 a = _mm_loadu_ps(dst + i);
+    __m128 b = _mm_loadu_ps(src + i);
+    _mm_storeu_ps(dst + i, _mm_add_ps(a, _mm_mul_ps(vk, b)));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] += k * src[i];
+  }
+}
+
+// Double-precision versions of the above.
+inline void Add(double* dst, const double* src, size_t n) {
+  size_t i = 0;
+#if defined(SIM_SIMD_AVX)
+  for (; i + 4 <= n; i += 4) {
+    __m256d a = _mm256_loadu_pd(dst + i);
+    __m256d b = _mm256_loadu_pd(src + i);
+    _mm256_storeu_pd(dst + i, _mm256_add_pd(a, b));
+  }
+#elif defined(SIM_SIMD_SSE)
+  for (; i + 2 <= n; i += 2) {
+    __m128d a = _mm_loadu_pd(dst + i);
+    __m128d b = _mm_loadu_pd(src + i);
+    _mm_storeu_pd(dst + i, _mm_add_pd(a, b));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] += src[i];
+  }
+}
+
+inline void Scale(double* dst, double k, size_t n) {
+  size_t i = 0;
+#if defined(SIM_SIMD_AVX)
+  __m256d vk = _mm256_set1_pd(k);
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(dst + i, _mm256_mul_pd(_mm256_loadu_pd(dst + i), vk));
+  }
+#elif defined(SIM_SIMD_SSE)
+  __m128d vk = _mm_set1_pd(k);
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(dst + i, _mm_mul_pd(_mm_loadu_pd(dst + i), vk));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] *= k;
+  }
+}
+
+inline void Axpy(double* dst, double k, const double* src, size_t n) {
+  size_t i = 0;
+#if defined(SIM_SIMD_AVX)
+  __m256d vk = _mm256_set1_pd(k);
+  for (; i + 4 <= n; i += 4) {
+    __m256d a = _mm256_loadu_pd(dst + i);
+    __m256d b = _mm256_loadu_pd(src + i);
+#if defined(__FMA__)
+    _mm256_storeu_pd(dst + i, _mm256_fmadd_pd(vk, b, a));
+#else
+    _mm256_storeu_pd(dst + i, _mm256_add_pd(a, _mm256_mul_pd(vk, b)));
+#endif
+  }
+#elif defined(SIM_SIMD_SSE)
+  __m128d vk = _mm_set1_pd(k);
+  for (; i + 2 <= n; i += 2) {
+    __m128d a = _mm_loadu_pd(dst + i);
+    __m128d b = _mm_loadu_pd(src + i);
+    _mm_storeu_pd(dst + i, _mm_add_pd(a, _mm_mul_pd(vk, b)));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] += k * src[i];
+  }
+}
+
+// Float-only kernels of the wind field.
+
+// dst[i] = a[i] + t * (b[i] - a[i])
+inline void Lerp(float* SIM_RESTRICT dst,
+                 const float* SIM_RESTRICT a,
+                 const float* SIM_RESTRICT b,
+                 float t,
+                 size_t n) {
+  size_t i = 0;
+#if defined(SIM_SIMD_AVX)
+  __m256 vt = _mm256_set1_ps(t);
+  for (; i + 8 <= n; i += 8) {
+    __m256 va = _mm256_loadu_ps(a + i);
+    __m256 d = _mm256_sub_ps(_mm256_loadu_ps(b + i), va);
+#if defined(__FMA__)
+    _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(vt, d, va));
+#else
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(va, _mm256_mul_ps(vt, d)));
+#endif
+  }
+#elif defined(SIM_SIMD_SSE)
+  __m128 vt = _mm_set1_ps(t);
+  for (; i + 4 <= n; i += 4) {
+    __m128 va = _mm_loadu_ps(a + i);
+    __m128 d = _mm_sub_ps(_mm_loadu_ps(b + i), va);
+    _mm_storeu_ps(dst + i, _mm_add_ps(va, _mm_mul_ps(vt, d)));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = a[i] + t * (b[i] - a[i]);
+  }
+}
+
+// Trilinear interpolation in a grid of 4-float vectors, where |v| is the
+// lower corner of a cell whose neighbours along y and z are |row| and |slab|
+// floats away, at fractions |fx|, |fy| and |fz| of the cell. Writes the first
+// three components to dst.
+inline void Trilinear4(float* dst,
+                       const float* v,
+                       size_t row,
+                       size_t slab,
+                       float fx,
+                       float fy,
+                       float fz) {
+#if defined(SIM_SIMD_AVX) || defined(SIM_SIMD_SSE)
+  __m128 tx = _mm_set1_ps(fx);
+  __m128 c[4];
+  const float* corners[4] = {v, v + row, v + slab, v + slab + row};
+  for (int k = 0; k < 4; k++) {
+    __m128 a = _mm_loadu_ps(corners[k]);
+    __m128 b = _mm_loadu_ps(corners[k] + 4);
+    c[k] = _mm_add_ps(a, _mm_mul_ps(tx, _mm_sub_ps(b, a)));
+  }
+  __m128 ty = _mm_set1_ps(fy);
+  __m128 c0 = _mm_add_ps(c[0], _mm_mul_ps(ty, _mm_sub_ps(c[1], c[0])));
+  __m128 c1 = _mm_add_ps(c[2], _mm_mul_ps(ty, _mm_sub_ps(c[3], c[2])));
+  __m128 tz = _mm_set1_ps(fz);
+  float result[4];
+  _mm_storeu_ps(result, _mm_add_ps(c0, _mm_mul_ps(tz, _mm_sub_ps(c1, c0))));
+#else
+  float result[4];
+  for (int i = 0; i < 3; i++) {
+    float c00 = v[i] + fx * (v[i + 4] - v[i]);
+    float c10 = v[i + row] + fx * (v[i + row + 4] - v[i + row]);
+    float c01 = v[i + slab] + fx * (v[i + slab + 4] - v[i + slab]);
+    float c11 = v[i + slab + row] +
+                fx * (v[i + slab + row + 4] - v[i + slab + row]);
+    float c0 = c00 + fy * (c10 - c00);
+    float c1 = c01 + fy * (c11 - c01);
+    result[i] = c0 + fz * (c1 - c0);
+  }
+#endif
+  dst[0] = result[0];
+  dst[1] = result[1];
+  dst[2] = result[2];
+}
+
+// dst = scale * dot(r, c) / |c| * c for c = cross(u, v), over n 3-vectors
+// stored as x, y and z arrays |stride| floats apart; 0 where c vanishes.
+// The square root is the hardware estimate refined by a Newton step, which
+// is accurate to a few units in the last place.
+inline void ProjectOnCross(float* SIM_RESTRICT dst,
+                           const float* SIM_RESTRICT u,
+                           const float* SIM_RESTRICT v,
+                           const float* SIM_RESTRICT r,
+                           float scale,
+                           size_t stride,
+                           size_t n) {
+  size_t i = 0;
+#if defined(SIM_SIMD_AVX) || defined(SIM_SIMD_SSE)
+  const __m128 vscale = _mm_set1_ps(scale);
+  const __m128 tiny = _mm_set1_ps(1e-24f);
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 three = _mm_set1_ps(3.0f);
+  for (; i + 4 <= n; i += 4) {
+    __m128 ux = _mm_loadu_ps(u + i);
+    __m128 uy = _mm_loadu_ps(u + stride + i);
+    __m128 uz = _mm_loadu_ps(u + 2 * stride + i);
+    __m128 vx = _mm_loadu_ps(v + i);
+    __m128 vy = _mm_loadu_ps(v + stride + i);
+    __m128 vz = _mm_loadu_ps(v + 2 * stride + i);
+    __m128 cx = _mm_sub_ps(_mm_mul_ps(uy, vz), _mm_mul_ps(uz, vy));
+    __m128 cy = _mm_sub_ps(_mm_mul_ps(uz, vx), _mm_mul_ps(ux, vz));
+    __m128 cz = _mm_sub_ps(_mm_mul_ps(ux, vy), _mm_mul_ps(uy, vx));
+    __m128 length_squared = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)),
+        _mm_mul_ps(cz, cz));
+    __m128 dot = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(r + i), cx),
+                   _mm_mul_ps(_mm_loadu_ps(r + stride + i), cy)),
+        _mm_mul_ps(_mm_loadu_ps(r + 2 * stride + i), cz));
+    __m128 y = _mm_rsqrt_ps(length_squared);
+    y = _mm_mul_ps(_mm_mul_ps(half, y),
+                   _mm_sub_ps(three, _mm_mul_ps(length_squared,
+                                                _mm_mul_ps(y, y))));
+    __m128 k = _mm_and_ps(_mm_cmpgt_ps(length_squared, tiny),
+                          _mm_mul_ps(vscale, _mm_mul_ps(dot, y)));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(k, cx));
+    _mm_storeu_ps(dst + stride + i, _mm_mul_ps(k, cy));
+    _mm_storeu_ps(dst + 2 * stride + i, _mm_mul_ps(k, cz));
+  }
+#endif
+  for (; i < n; i++) {
+    float cx =
+        u[stride + i] * v[2 * stride + i] - u[2 * stride + i] * v[stride + i];
+    float cy = u[2 * stride + i] * v[i] - u[i] * v[2 * stride + i];
+    float cz = u[i] * v[stride + i] - u[stride + i] * v[i];
+    float length_squared = cx * cx + cy * cy + cz * cz;
+    float dot = r[i] * cx + r[stride + i] * cy + r[2 * stride + i] * cz;
+    float k = length_squared > 1e-24f
+                  ? scale * dot / std::sqrt(length_squared)
+                  : 0.0f;
+    dst[i] = k * cx;
+    dst[stride + i] = k * cy;
+    dst[2 * stride + i] = k * cz;
+  }
+}
+}  // namespace simd
+}  // namespace GLOO
+
+#endif
@@ -2,9 +2,11 @@
 #define SIMPLE_CIRCULAR_NODE_H_
 
 #include "gloo/SceneNode.hpp"
+#include "FixedStepScheduler.hpp"
 #include "IntegratorBase.hpp"
 #include "ParticleState.hpp"
 #include "SimpleCircularSystem.hpp"
+#include "SimulationScenes.hpp"
 
 #include "gloo/components/RenderingComponent.hpp"
 #include "gloo/components/ShadingComponent.hpp"
@@ -18,13 +20,13 @@ class SimpleCircularNode : public SceneNode {
         SimpleCircularNode(float integration_step,
                            std::unique_ptr<IntegratorBase<SimpleCircularSystem, ParticleState>> integrator)
                             : integration_step_(integration_step),
+                            scheduler_(integration_step),
                             integrator_(std::move(integrator)),
-                            time_(0.0f) {
-                // Initialize state with single particle
-                state_.positions.resize(1);
-                state_.velocities.resize(1);
-                state_.positions[0] = glm::vec3(1.0f, 0.0f, 0.0f);
-                state_.velocities[0] = glm::vec3(0.0f);
+                            time_(0.0) {
+                workspace_.adaptive_step = integration_step_;
+
+                state_ = BuildCircularScene<SimpleCircularSystem>().initial_state;
+                previous_position_ = state_.positions[0];
 
                 auto sphere_mesh = PrimitiveFactory::CreateSphere(0.05f, 10, 10);
                 CreateComponent<RenderingComponent>(std::move(sphere_mesh));
@@ -44,24 +46,33 @@ class SimpleCircularNode : public SceneNode {
             }
         
         void Update(double delta_time) override {
-            float time_remaining = static_cast<float>(delta_time);
-
-            while (time_remaining > 0.0f) {
-                float step = std::min(time_remaining, integration_step_);
-                state_ = integrator_->Integrate(system_, state_, time_, step);
-                time_ += step;
-                time_remaining -= step;
+            int steps = scheduler_.Advance(delta_time);
+            if (steps > 0) {
+                // All but the last step in one batch; the last step's
+                // starting position is kept for blending.
+                integrator_->IntegrateSteps(system_, state_, time_,
+                                            integration_step_, steps - 1,
+                                            workspace_);
+                time_ += (steps - 1) * static_cast<double>(integration_step_);
+                previous_position_ = state_.positions[0];
+                integrator_->IntegrateSteps(system_, state_, time_,
+                                            integration_step_, 1, workspace_);
+                time_ += integration_step_;
             }
 
-            GetTransform().SetPosition(state_.positions[0]);
+            GetTransform().SetPosition(glm::mix(
+                previous_position_, state_.positions[0], scheduler_.GetAlpha()));
         }
 
     private:
         float integration_step_;
+        FixedStepScheduler scheduler_;
         std::unique_ptr<IntegratorBase<SimpleCircularSystem, ParticleState>> integrator_;
         SimpleCircularSystem system_;
         ParticleState state_;
-        float time_;
+        glm::vec3 previous_position_;
+        IntegratorWorkspace<ParticleState> workspace_;
+        double time_;
 };
 } // namespace GLOO
 
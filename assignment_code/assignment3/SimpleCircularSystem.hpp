@@ -4,22 +4,28 @@
 #include "ParticleSystemBase.hpp"
 
 namespace GLOO {
-class SimpleCircularSystem : public ParticleSystemBase {
+template <class T>
+class SimpleCircularSystemT final : public ParticleSystemBaseT<T> {
     public:
-        ParticleState ComputeTimeDerivative(const ParticleState& state,
-                                            float time) const override {
+        typedef ParticleStateT<T> State;
+        typedef typename State::Vec3 Vec3;
+
+        using ParticleSystemBaseT<T>::ComputeTimeDerivative;
+
+        void ComputeTimeDerivative(const State& state,
+                                   double time,
+                                   State& derivative) const override {
             // ParticleState with a single particle
-            ParticleState derivative;
             derivative.positions.resize(1);
             derivative.velocities.resize(1);
 
-            const glm::vec3& pos = state.positions[0];
-            derivative.positions[0] = glm::vec3(-pos.y, pos.x, 0.0f);
-            derivative.velocities[0] = glm::vec3(0.0f);
-
-            return derivative;
+            const Vec3& pos = state.positions[0];
+            derivative.positions[0] = Vec3(-pos.y, pos.x, T(0));
+            derivative.velocities[0] = Vec3(T(0));
         }
     };
+
+typedef SimpleCircularSystemT<float> SimpleCircularSystem;
 } // namespace GLOO
 
 
@@ -13,21 +13,32 @@
 #include "gloo/lights/AmbientLight.hpp"
 #include "gloo/cameras/ArcBallCameraNode.hpp"
 #include "gloo/debug/AxisNode.hpp"
+#include "gloo/debug/PrimitiveFactory.hpp"
+#include "gloo/utils.hpp"
 
+#include "ClothSolverFactory.hpp"
 #include "IntegratorFactory.hpp"
+#include "SimulationScenes.hpp"
 #include "SimpleCircularNode.hpp"
 #include "PendulumNode.hpp"
 #include "ClothNode.hpp"
+#include "TrajectoryReplayNode.hpp"
 
 
 namespace GLOO {
 SimulationApp::SimulationApp(const std::string& app_name,
                              glm::ivec2 window_size,
                              IntegratorType integrator_type,
-                             float integration_step)
+                             float integration_step,
+                             ClothSolverType cloth_solver_type,
+                             const std::string& replay_path,
+                             const std::string& prop_path)
     : Application(app_name, window_size),
       integrator_type_(integrator_type),
-      integration_step_(integration_step) {
+      integration_step_(integration_step),
+      cloth_solver_type_(cloth_solver_type),
+      replay_path_(replay_path),
+      prop_path_(prop_path) {
 }
 
 void SimulationApp::SetupScene() {
@@ -62,155 +73,97 @@ void SimulationApp::SetupScene() {
     root.AddChild(std::move(simple_node));
   }
 
+  // A recorded trajectory replaces the simulation of the scene it was
+  // recorded from, the pendulum or the cloth.
+  std::shared_ptr<TrajectoryReader> reader;
+  if (!replay_path_.empty()) {
+    reader = std::make_shared<TrajectoryReader>(replay_path_);
+  }
+
   // ========== Example 2: Pendulum Chain (Middle) ==========
   {
-    // Create pendulum system with 4 particles
-    auto system = std::make_shared<PendulumSystem>();
-    
-    // Set physics parameters
-    system->SetGravity(glm::vec3(0.0f, -9.8f, 0.0f));
-    system->SetDragCoefficient(0.5f);  // Adjust for stability
-    
-    // Add 4 particles in a vertical chain
-    const int num_particles = 4;
-    const float particle_mass = 1.0f;
-    const float spring_stiffness = 100.0f;
-    const float spring_rest_length = 0.5f;
-    
-    for (int i = 0; i < num_particles; i++) {
-      system->AddParticle(particle_mass, false);
-    }
-    
-    // Fix the first particle (top of chain)
-    system->SetParticleFixed(0, true);
-    
-    // Connect particles with springs to form a chain
-    for (int i = 0; i < num_particles - 1; i++) {
-      system->AddSpring(i, i + 1, spring_stiffness, spring_rest_length);
+    auto scene = BuildPendulumScene<PendulumSystem>();
+    if (reader != nullptr &&
+        reader->GetTopologyHash() == ComputeTopologyHash(*scene.system)) {
+      auto replay_node = make_unique<TrajectoryReplayNode>(
+          reader, TrajectoryReplayNode::MakeSpringEdges(*scene.system));
+      replay_node->GetTransform().SetPosition(glm::vec3(0.0f, 2.0f, 0.0f));
+      root.AddChild(std::move(replay_node));
+      // The cloth is then simulated as usual.
+      reader.reset();
+    } else {
+      auto integrator = IntegratorFactory::CreateIntegrator<PendulumSystem, ParticleState>(
+          integrator_type_);
+      auto pendulum_node = make_unique<PendulumNode>(
+          integration_step_, std::move(integrator), scene.system,
+          scene.initial_state);
+      pendulum_node->GetTransform().SetPosition(glm::vec3(0.0f, 2.0f, 0.0f));
+      root.AddChild(std::move(pendulum_node));
     }
-    
-    // Initialize particle positions (vertical chain)
-    ParticleState initial_state;
-    initial_state.positions.resize(num_particles);
-    initial_state.velocities.resize(num_particles);
-    
-    for (int i = 0; i < num_particles; i++) {
-      initial_state.positions[i] = glm::vec3(0.0f, -i * spring_rest_length, 0.0f);
-      initial_state.velocities[i] = glm::vec3(0.0f);
-    }
-    
-    // Create integrator and node
-    auto integrator = IntegratorFactory::CreateIntegrator<PendulumSystem, ParticleState>(
-        integrator_type_);
-    auto pendulum_node = make_unique<PendulumNode>(
-        integration_step_, std::move(integrator), system, initial_state);
-    pendulum_node->GetTransform().SetPosition(glm::vec3(0.0f, 2.0f, 0.0f));
-    root.AddChild(std::move(pendulum_node));
   }
 
   // ========== Example 3: Cloth (Right) ==========
   {
-    // Create cloth system with 8x8 grid of particles
-    auto system = std::make_shared<PendulumSystem>();
-    
-    // Set physics parameters
-    system->SetGravity(glm::vec3(0.0f, -9.8f, 0.0f));
-    system->SetDragCoefficient(2.0f);  // Higher drag for cloth stability
-    
-    const int grid_size = 8;
-    const float particle_mass = 0.5f;
-    const float spacing = 0.25f;  // Distance between adjacent particles
-    
-    // Spring stiffness values
-    const float structural_stiffness = 80.0f;
-    const float shear_stiffness = 40.0f;
-    const float flex_stiffness = 40.0f;
-    
-    // Helper function to get particle index from grid coordinates
-    auto IndexOf = [grid_size](int i, int j) -> int {
-      return i * grid_size + j;
-    };
-    
-    // Add all particles in a grid
-    for (int i = 0; i < grid_size; i++) {
-      for (int j = 0; j < grid_size; j++) {
-        system->AddParticle(particle_mass, false);
-      }
-    }
-    
-    // Fix the top two corners
-    system->SetParticleFixed(IndexOf(0, 0), true);
-    system->SetParticleFixed(IndexOf(0, grid_size - 1), true);
-    
-    // Add structural springs (horizontal and vertical neighbors)
-    for (int i = 0; i < grid_size; i++) {
-      for (int j = 0; j < grid_size; j++) {
-        // Horizontal spring to the right
-        if (j < grid_size - 1) {
-          system->AddSpring(IndexOf(i, j), IndexOf(i, j + 1), 
-                           structural_stiffness, spacing);
-        }
-        
-        // Vertical spring downward
-        if (i < grid_size - 1) {
-          system->AddSpring(IndexOf(i, j), IndexOf(i + 1, j), 
-                           structural_stiffness, spacing);
-        }
+    const int grid_size = kDefaultClothGridSize;
+    auto scene = BuildClothScene<PendulumSystem>(grid_size);
+    if (reader != nullptr) {
+      if (reader->GetTopologyHash() != ComputeTopologyHash(*scene.system)) {
+        throw std::runtime_error("Trajectory " + replay_path_ +
+                                 " was not recorded from the pendulum or "
+                                 "this cloth!");
       }
+      auto replay_node = make_unique<TrajectoryReplayNode>(
+          reader, TrajectoryReplayNode::MakeGridEdges(grid_size));
+      replay_node->GetTransform().SetPosition(glm::vec3(3.0f, 2.0f, 0.0f));
+      root.AddChild(std::move(replay_node));
+      return;
     }
-    
-    // Add shear springs (diagonal neighbors)
-    for (int i = 0; i < grid_size - 1; i++) {
-      for (int j = 0; j < grid_size - 1; j++) {
-        // Diagonal down-right
-        system->AddSpring(IndexOf(i, j), IndexOf(i + 1, j + 1), 
-                         shear_stiffness, spacing * std::sqrt(2.0f));
-        
-        // Diagonal down-left
-        system->AddSpring(IndexOf(i, j + 1), IndexOf(i + 1, j), 
-                         shear_stiffness, spacing * std::sqrt(2.0f));
-      }
-    }
-    
-    // Add flex springs (skip one particle - 2 units away)
-    for (int i = 0; i < grid_size; i++) {
-      for (int j = 0; j < grid_size; j++) {
-        // Horizontal flex spring (2 units right)
-        if (j < grid_size - 2) {
-          system->AddSpring(IndexOf(i, j), IndexOf(i, j + 2), 
-                           flex_stiffness, spacing * 2.0f);
-        }
-        
-        // Vertical flex spring (2 units down)
-        if (i < grid_size - 2) {
-          system->AddSpring(IndexOf(i, j), IndexOf(i + 2, j), 
-                           flex_stiffness, spacing * 2.0f);
-        }
-      }
-    }
-    
-    // Initialize particle positions in a grid
-    ParticleState initial_state;
-    initial_state.positions.resize(grid_size * grid_size);
-    initial_state.velocities.resize(grid_size * grid_size);
-    
-    for (int i = 0; i < grid_size; i++) {
-      for (int j = 0; j < grid_size; j++) {
-        int idx = IndexOf(i, j);
-        initial_state.positions[idx] = glm::vec3(
-          j * spacing - (grid_size - 1) * spacing / 2.0f,  // Center horizontally
-          -i * spacing,                                      // Hang downward
-          0.0f
-        );
-        initial_state.velocities[idx] = glm::vec3(0.0f);
-      }
-    }
-    
-    // Create integrator and node
+    AddBreeze(*scene.system);
     auto integrator = IntegratorFactory::CreateIntegrator<PendulumSystem, ParticleState>(
         integrator_type_);
     auto cloth_node = make_unique<ClothNode>(
-        integration_step_, std::move(integrator), system, initial_state, grid_size);
+        integration_step_, std::move(integrator), scene.system,
+        scene.initial_state, grid_size);
+    cloth_node->SetSolver(ClothSolverFactory::CreateSolver(
+        cloth_solver_type_, scene.system, integration_step_));
+
+    auto prop_node = make_unique<SceneNode>();
+    std::shared_ptr<Collider> prop;
+    if (prop_path_.empty()) {
+      auto sphere = BuildSwingingSphere(grid_size);
+      prop_node->CreateComponent<RenderingComponent>(
+          PrimitiveFactory::CreateSphere(sphere->GetRadius(), 24, 24));
+      prop = sphere;
+    } else {
+      MeshData mesh_data = MeshLoader::Import(prop_path_);
+      if (mesh_data.vertex_obj == nullptr ||
+          !mesh_data.vertex_obj->HasIndices()) {
+        throw std::runtime_error("Cannot load prop " + prop_path_ + "!");
+      }
+      auto positions =
+          make_unique<PositionArray>(mesh_data.vertex_obj->GetPositions());
+      const IndexArray& indices = mesh_data.vertex_obj->GetIndices();
+      auto mesh = BuildSwingingMesh(*positions, indices, grid_size);
+      // Rendered with the fitted positions and the collider's normals, as
+      // OBJ normals may be missing or indexed apart from the positions.
+      auto vertex_obj = std::make_shared<VertexObject>();
+      vertex_obj->UpdateNormals(
+          make_unique<NormalArray>(mesh->GetVertexNormals()));
+      vertex_obj->UpdatePositions(std::move(positions));
+      vertex_obj->UpdateIndices(make_unique<IndexArray>(indices));
+      prop_node->CreateComponent<RenderingComponent>(vertex_obj);
+      // Collisions use the distance grid, baked once and then cached next
+      // to the OBJ file.
+      prop = BuildSwingingSdf(*mesh, vertex_obj->GetPositions(), indices,
+                              grid_size, GetAssetDir() + prop_path_ + ".sdf");
+    }
+    prop_node->CreateComponent<ShadingComponent>(
+        std::make_shared<PhongShader>());
+    prop_node->CreateComponent<MaterialComponent>(std::make_shared<Material>(
+        glm::vec3(0.6f, 0.2f, 0.0f), glm::vec3(0.8f, 0.4f, 0.1f),
+        glm::vec3(0.4f), 16.0f));
+    cloth_node->AddCollider(prop, std::move(prop_node));
+    cloth_node->SetSelfCollision(kClothSelfCollisionDistance);
     cloth_node->GetTransform().SetPosition(glm::vec3(3.0f, 2.0f, 0.0f));
     root.AddChild(std::move(cloth_node));
   }
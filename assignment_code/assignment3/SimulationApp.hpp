@@ -1,9 +1,12 @@
 #ifndef SIMULATION_APP_H_
 #define SIMULATION_APP_H_
 
+#include <string>
+
 #include "gloo/Application.hpp"
 
 #include "IntegratorType.hpp"
+#include "ClothSolverType.hpp"
 
 namespace GLOO {
 class SimulationApp : public Application {
@@ -11,12 +14,22 @@ class SimulationApp : public Application {
   SimulationApp(const std::string& app_name,
                 glm::ivec2 window_size,
                 IntegratorType integrator_type,
-                float integration_step);
+                float integration_step,
+                ClothSolverType cloth_solver_type = ClothSolverType::MassSpring,
+                const std::string& replay_path = "",
+                const std::string& prop_path = "");
   void SetupScene() override;
 
  private:
   IntegratorType integrator_type_;
   float integration_step_;
+  ClothSolverType cloth_solver_type_;
+  // Trajectory file to show in place of the simulated cloth, if not empty.
+  std::string replay_path_;
+  // OBJ file, relative to the assets directory, swung through the cloth in
+  // place of the sphere, if not empty. Its distance grid is cached next to
+  // it with an added .sdf extension.
+  std::string prop_path_;
 };
 }  // namespace GLOO
 
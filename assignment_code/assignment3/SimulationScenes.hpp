@@ -0,0 +1,335 @@
+#ifndef SIMULATION_SCENES_H_
+#define SIMULATION_SCENES_H_
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "DragForce.hpp"
+#include "GravityForce.hpp"
+#include "MeshCollider.hpp"
+#include "ParticleState.hpp"
+#include "PendulumSystem.hpp"
+#include "SdfCollider.hpp"
+#include "SimpleCircularSystem.hpp"
+#include "SphereCollider.hpp"
+#include "SpringForce.hpp"
+#include "WindField.hpp"
+#include "WindForce.hpp"
+
+namespace GLOO {
+// The systems of SimulationApp's scene without any rendering, so the viewer
+// and the headless tools simulate exactly the same thing. The builders are
+// templates on the system type to allow every precision mode.
+template <class TSystem>
+struct SimulationScene {
+  std::shared_ptr<TSystem> system;
+  typename TSystem::State initial_state;
+};
+
+const int kDefaultClothGridSize = 8;
+// Drag coefficient of the cloth of BuildClothScene(), in still air.
+const float kClothDragCoefficient = 2.0f;
+// Minimum distance between unconnected particles of the cloth, well below
+// the particle spacing of BuildClothScene().
+const float kClothSelfCollisionDistance = 0.1f;
+
+// A single particle circling the origin.
+template <class TSystem>
+SimulationScene<TSystem> BuildCircularScene() {
+  typedef typename TSystem::State::Vec3 Vec3;
+  SimulationScene<TSystem> scene;
+  scene.system = std::make_shared<TSystem>();
+  scene.initial_state.positions.assign(1, Vec3(1, 0, 0));
+  scene.initial_state.velocities.assign(1, Vec3(0));
+  return scene;
+}
+
+// Registers gravity, drag of coefficient |drag| and spring forces with
+// |system|, the forces of the mass-spring scenes.
+template <class TSystem>
+void AddMassSpringForces(TSystem& system, float drag) {
+  typedef typename TSystem::State::Scalar Scalar;
+  system.AddForce(std::make_shared<GravityForceT<Scalar>>(
+      glm::vec3(0.0f, -9.8f, 0.0f)));
+  system.AddForce(std::make_shared<DragForceT<Scalar>>(drag));
+  system.AddForce(std::make_shared<
+                  SpringForceT<Scalar, typename TSystem::ForceScalar>>());
+}
+
+// A vertical chain of four particles hanging from the first.
+template <class TSystem>
+SimulationScene<TSystem> BuildPendulumScene() {
+  typedef typename TSystem::State::Vec3 Vec3;
+  SimulationScene<TSystem> scene;
+  scene.system = std::make_shared<TSystem>();
+  TSystem& system = *scene.system;
+  AddMassSpringForces(system, 0.5f);
+
+  const int num_particles = 4;
+  const float particle_mass = 1.0f;
+  const float spring_stiffness = 100.0f;
+  const float spring_rest_length = 0.5f;
+  for (int i = 0; i < num_particles; i++) {
+    system.AddParticle(particle_mass, false);
+  }
+  system.SetParticleFixed(0, true);
+  for (int i = 0; i < num_particles - 1; i++) {
+    system.AddSpring(i, i + 1, spring_stiffness, spring_rest_length);
+  }
+
+  scene.initial_state.positions.resize(num_particles);
+  scene.initial_state.velocities.assign(num_particles, Vec3(0));
+  for (int i = 0; i < num_particles; i++) {
+    scene.initial_state.positions[i] =
+        Vec3(glm::vec3(0.0f, -i * spring_rest_length, 0.0f));
+  }
+  return scene;
+}
+
+// A grid_size x grid_size cloth hanging from its top corners, with
+// structural, shear and flex springs.
+template <class TSystem>
+SimulationScene<TSystem> BuildClothScene(
+    int grid_size = kDefaultClothGridSize) {
+  typedef typename TSystem::State::Vec3 Vec3;
+  SimulationScene<TSystem> scene;
+  scene.system = std::make_shared<TSystem>();
+  TSystem& system = *scene.system;
+  AddMassSpringForces(system, kClothDragCoefficient);
+
+  const float particle_mass = 0.5f;
+  const float spacing = 0.25f;
+  const float structural_stiffness = 80.0f;
+  const float shear_stiffness = 40.0f;
+  const float flex_stiffness = 40.0f;
+  auto index_of = [grid_size](int i, int j) { return i * grid_size + j; };
+
+  for (int i = 0; i < grid_size * grid_size; i++) {
+    system.AddParticle(particle_mass, false);
+  }
+  system.SetParticleFixed(index_of(0, 0), true);
+  system.SetParticleFixed(index_of(0, grid_size - 1), true);
+
+  // Structural springs to the right and downward neighbors.
+  for (int i = 0; i < grid_size; i++) {
+    for (int j = 0; j < grid_size; j++) {
+      if (j < grid_size - 1) {
+        system.AddSpring(index_of(i, j), index_of(i, j + 1),
+                         structural_stiffness, spacing);
+      }
+      if (i < grid_size - 1) {
+        system.AddSpring(index_of(i, j), index_of(i + 1, j),
+                         structural_stiffness, spacing);
+      }
+    }
+  }
+  // Shear springs along both diagonals of every cell.
+  for (int i = 0; i < grid_size - 1; i++) {
+    for (int j = 0; j < grid_size - 1; j++) {
+      system.AddSpring(index_of(i, j), index_of(i + 1, j + 1),
+                       shear_stiffness, spacing * std::sqrt(2.0f));
+      system.AddSpring(index_of(i, j + 1), index_of(i + 1, j),
+                       shear_stiffness, spacing * std::sqrt(2.0f));
+    }
+  }
+  // Flex springs skipping one particle.
+  for (int i = 0; i < grid_size; i++) {
+    for (int j = 0; j < grid_size; j++) {
+      if (j < grid_size - 2) {
+        system.AddSpring(index_of(i, j), index_of(i, j + 2), flex_stiffness,
+                         spacing * 2.0f);
+      }
+      if (i < grid_size - 2) {
+        system.AddSpring(index_of(i, j), index_of(i + 2, j), flex_stiffness,
+                         spacing * 2.0f);
+      }
+    }
+  }
+
+  // Two triangles per cell, which catch the wind if there is any.
+  for (int i = 0; i < grid_size - 1; i++) {
+    for (int j = 0; j < grid_size - 1; j++) {
+      system.AddTriangle(index_of(i, j), index_of(i + 1, j),
+                         index_of(i, j + 1));
+      system.AddTriangle(index_of(i + 1, j), index_of(i + 1, j + 1),
+                         index_of(i, j + 1));
+    }
+  }
+
+  // Centered horizontally, hanging downward in the xy plane.
+  scene.initial_state.positions.resize(grid_size * grid_size);
+  scene.initial_state.velocities.assign(grid_size * grid_size, Vec3(0));
+  for (int i = 0; i < grid_size; i++) {
+    for (int j = 0; j < grid_size; j++) {
+      scene.initial_state.positions[index_of(i, j)] = Vec3(glm::vec3(
+          j * spacing - (grid_size - 1) * spacing / 2.0f, -i * spacing, 0.0f));
+    }
+  }
+  return scene;
+}
+
+// Pressure coefficient of the wind on the cloth of BuildClothScene().
+const float kClothWindPressure = 4.0f;
+
+// A gusty breeze blowing through the cloth of BuildClothScene() along +z.
+// Its finest gusts span about four particles, so a grid with the particle
+// spacing, rebaked every 250 ms, resolves it to within a tenth of the gust
+// speed; pass false for |cached| to evaluate the noise at every particle.
+inline std::shared_ptr<WindField> BuildBreeze(bool cached = true) {
+  auto wind = std::make_shared<WindField>(glm::vec3(0.0f, 0.0f, 0.6f), 1.2f,
+                                          2.0f, 2);
+  if (cached) {
+    wind->SetGridCache(0.25f, 0.25);
+  }
+  return wind;
+}
+
+// Blows BuildBreeze(|cached|) through the cloth of BuildClothScene(), or
+// any system with the drag of AddMassSpringForces(), whose coefficient the
+// wind follows.
+template <class TSystem>
+void AddBreeze(TSystem& system, bool cached = true) {
+  typedef typename TSystem::State::Scalar Scalar;
+  std::shared_ptr<const DragForceT<Scalar>> drag;
+  for (const auto& force : system.GetForces()) {
+    drag = std::dynamic_pointer_cast<const DragForceT<Scalar>>(force);
+    if (drag != nullptr) {
+      break;
+    }
+  }
+  if (drag == nullptr) {
+    throw std::runtime_error("The breeze needs a system with drag!");
+  }
+  system.AddForce(std::make_shared<WindForceT<Scalar>>(
+      BuildBreeze(cached), drag, kClothWindPressure));
+}
+
+// Radius of the props swung through the cloth of BuildClothScene(grid_size).
+inline float GetPropRadius(int grid_size = kDefaultClothGridSize) {
+  const float spacing = 0.25f;
+  return 0.3f * (grid_size - 1) * spacing;
+}
+
+// Back and forth through the middle of the cloth of
+// BuildClothScene(grid_size), as in the assignment's sample solution.
+inline KinematicPath BuildSwingPath(int grid_size = kDefaultClothGridSize) {
+  const float spacing = 0.25f;
+  const float cloth_size = (grid_size - 1) * spacing;
+  const float amplitude = 2.0f * GetPropRadius(grid_size);
+  const double angular_speed = 1.5;
+  return KinematicPath([=](double time) {
+    return glm::vec3(0.0f, -0.5f * cloth_size,
+                     -amplitude * std::cos(angular_speed * time));
+  });
+}
+
+inline std::shared_ptr<SphereCollider> BuildSwingingSphere(
+    int grid_size = kDefaultClothGridSize) {
+  return std::make_shared<SphereCollider>(GetPropRadius(grid_size),
+                                          BuildSwingPath(grid_size));
+}
+
+// Centers |positions| and scales them in place so that the mesh fits in the
+// sphere of BuildSwingingSphere(grid_size).
+inline void FitPropMesh(std::vector<glm::vec3>& positions,
+                        int grid_size = kDefaultClothGridSize) {
+  if (positions.empty()) {
+    throw std::runtime_error("Mesh prop has no vertices!");
+  }
+  glm::vec3 lo = positions[0];
+  glm::vec3 hi = positions[0];
+  for (const glm::vec3& position : positions) {
+    lo = glm::min(lo, position);
+    hi = glm::max(hi, position);
+  }
+  glm::vec3 center = 0.5f * (lo + hi);
+  float extent = 0.0f;
+  for (const glm::vec3& position : positions) {
+    extent = std::max(extent, glm::length(position - center));
+  }
+  float scale = extent > 0.0f ? GetPropRadius(grid_size) / extent : 1.0f;
+  for (glm::vec3& position : positions) {
+    position = (position - center) * scale;
+  }
+}
+
+// A mesh prop on the path of the sphere. |positions| are fitted in place
+// with FitPropMesh(), and can be rendered as is.
+inline std::shared_ptr<MeshCollider> BuildSwingingMesh(
+    std::vector<glm::vec3>& positions,
+    const std::vector<unsigned int>& indices,
+    int grid_size = kDefaultClothGridSize) {
+  FitPropMesh(positions, grid_size);
+  return std::make_shared<MeshCollider>(positions, indices,
+                                        0.5f * GetPropRadius(grid_size),
+                                        BuildSwingPath(grid_size));
+}
+
+// Nodes along the longest side of the distance grids of props.
+const int kPropGridResolution = 64;
+
+// The distance grid of a prop of BuildSwingingMesh(), on the same path. The
+// grid is read from |cache_path| if it was baked there from the same mesh,
+// and baked and written there otherwise.
+inline std::shared_ptr<SdfCollider> BuildSwingingSdf(
+    const MeshCollider& mesh,
+    const std::vector<glm::vec3>& positions,
+    const std::vector<unsigned int>& indices,
+    int grid_size = kDefaultClothGridSize,
+    const std::string& cache_path = "") {
+  return std::make_shared<SdfCollider>(
+      LoadOrBakeDistanceGrid(mesh, positions, indices, kPropGridResolution,
+                             0.25f * GetPropRadius(grid_size), cache_path),
+      BuildSwingPath(grid_size));
+}
+
+// A closed unit sphere with radial bumps and about 4 * rings^2 triangles,
+// standing in for a detailed prop where no OBJ file can be loaded.
+inline void BuildBumpySphereMesh(int rings,
+                                 std::vector<glm::vec3>& positions,
+                                 std::vector<unsigned int>& indices) {
+  const int segments = 2 * rings;
+  const float pi = 3.14159265f;
+  positions.clear();
+  indices.clear();
+  // A vertex at each pole and a ring of vertices at each inner latitude.
+  positions.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+  for (int i = 1; i < rings; i++) {
+    float theta = pi * i / rings;
+    for (int j = 0; j < segments; j++) {
+      float phi = 2.0f * pi * j / segments;
+      float radius = 1.0f + 0.1f * std::sin(6.0f * theta) * std::sin(5.0f * phi);
+      positions.push_back(radius * glm::vec3(std::sin(theta) * std::cos(phi),
+                                             std::cos(theta),
+                                             -std::sin(theta) * std::sin(phi)));
+    }
+  }
+  positions.push_back(glm::vec3(0.0f, -1.0f, 0.0f));
+  const unsigned int south = static_cast<unsigned int>(positions.size() - 1);
+  auto ring_vertex = [segments](int i, int j) {
+    return static_cast<unsigned int>(1 + (i - 1) * segments + j % segments);
+  };
+  for (int j = 0; j < segments; j++) {
+    indices.insert(indices.end(),
+                   {0u, ring_vertex(1, j), ring_vertex(1, j + 1)});
+    indices.insert(indices.end(), {south, ring_vertex(rings - 1, j + 1),
+                                   ring_vertex(rings - 1, j)});
+  }
+  for (int i = 1; i < rings - 1; i++) {
+    for (int j = 0; j < segments; j++) {
+      unsigned int a = ring_vertex(i, j);
+      unsigned int b = ring_vertex(i, j + 1);
+      unsigned int c = ring_vertex(i + 1, j);
+      unsigned int d = ring_vertex(i + 1, j + 1);
+      indices.insert(indices.end(), {a, c, d});
+      indices.insert(indices.end(), {a, d, b});
+    }
+  }
+}
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef SKYLINE_CHOLESKY_H_
+#define SKYLINE_CHOLESKY_H_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace GLOO {
+// Cholesky factorization A = L L^T of a symmetric positive definite matrix in
+// skyline (envelope) storage: row i keeps only columns first_column[i]..i of
+// its lower triangle. Fill-in stays inside the envelope, so for meshes whose
+// particles are numbered row by row (like the cloth grid) storage and solve
+// cost are O(n * bandwidth). Factor once, then Solve() is two triangular
+// sweeps.
+class SkylineCholesky {
+ public:
+  // Sets the sparsity pattern and zeroes all entries.
+  void Reset(const std::vector<int>& first_column) {
+    first_column_ = first_column;
+    row_start_.resize(first_column_.size() + 1);
+    row_start_[0] = 0;
+    for (size_t i = 0; i < first_column_.size(); i++) {
+      row_start_[i + 1] = row_start_[i] + (i - first_column_[i] + 1);
+    }
+    values_.assign(row_start_.back(), 0.0);
+  }
+
+  size_t GetSize() const {
+    return first_column_.size();
+  }
+
+  // Adds |value| at (row, col) of A; requires first_column[row] <= col <= row.
+  void Add(int row, int col, double value) {
+    At(row, col) += value;
+  }
+
+  // Replaces A by its factor L in place. Returns false if A is not positive
+  // definite.
+  bool Factor() {
+    int n = static_cast<int>(first_column_.size());
+    for (int i = 0; i < n; i++) {
+      for (int j = first_column_[i]; j <= i; j++) {
+        int k0 = std::max(first_column_[i], first_column_[j]);
+        const double* li = &At(i, k0);
+        const double* lj = &At(j, k0);
+        double sum = At(i, j);
+        for (int k = 0; k < j - k0; k++) {
+          sum -= li[k] * lj[k];
+        }
+        if (j < i) {
+          At(i, j) = sum / At(j, j);
+        } else {
+          if (sum <= 0.0) {
+            return false;
+          }
+          At(i, i) = std::sqrt(sum);
+        }
+      }
+    }
+    return true;
+  }
+
+  // Solves A x = b in place with the factor from Factor(). T may be a scalar
+  // or a vector type such as glm::dvec3 to solve several right-hand sides
+  // sharing the matrix at once.
+  template <class T>
+  void Solve(std::vector<T>& b) const {
+    int n = static_cast<int>(first_column_.size());
+    for (int i = 0; i < n; i++) {
+      T sum = b[i];
+      for (int k = first_column_[i]; k < i; k++) {
+        sum -= At(i, k) * b[k];
+      }
+      b[i] = sum / At(i, i);
+    }
+    for (int i = n - 1; i >= 0; i--) {
+      b[i] = b[i] / At(i, i);
+      for (int k = first_column_[i]; k < i; k++) {
+        b[k] -= At(i, k) * b[i];
+      }
+    }
+  }
+
+ private:
+  double& At(int i, int j) {
+    return values_[row_start_[i] + (j - first_column_[i])];
+  }
+  double At(int i, int j) const {
+    return values_[row_start_[i] + (j - first_column_[i])];
+  }
+
+  std::vector<int> first_column_;
+  std::vector<size_t> row_start_;
+  std::vector<double> values_;
+};
+}  // namespace GLOO
+
+#endif
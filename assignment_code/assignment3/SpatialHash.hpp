@@ -0,0 +1,163 @@
+#ifndef SPATIAL_HASH_H_
+#define SPATIAL_HASH_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace GLOO {
+// Uniform grid over particle positions, stored as a hash table with a
+// counting sort: particle indices are sorted by the bucket of their cell, and
+// each bucket is a contiguous range of the sorted list. Rebuilding is a few
+// linear passes without allocation once the table has grown, so it is cheap
+// enough to redo every step. Cells that hash to the same bucket share it, so
+// queries return a superset of the particles in the cells asked for.
+class SpatialHash {
+ public:
+  explicit SpatialHash(float cell_size = 0.25f) : cell_size_(cell_size) {
+  }
+
+  void SetCellSize(float cell_size) {
+    cell_size_ = cell_size;
+  }
+
+  float GetCellSize() const {
+    return cell_size_;
+  }
+
+  size_t GetNumParticles() const {
+    return sorted_.size();
+  }
+
+  template <class TVec>
+  void Build(const std::vector<TVec>& positions) {
+    size_t num_particles = positions.size();
+    // About two buckets per particle keeps collisions between cells rare.
+    size_t table_size = 1;
+    while (table_size < 2 * num_particles) {
+      table_size *= 2;
+    }
+    mask_ = table_size - 1;
+    bucket_start_.assign(table_size + 1, 0);
+    particle_buckets_.resize(num_particles);
+    sorted_.resize(num_particles);
+
+    float inverse_cell_size = 1.0f / cell_size_;
+    for (size_t i = 0; i < num_particles; i++) {
+      size_t bucket =
+          GetBucket(GetCell(glm::vec3(positions[i]), inverse_cell_size));
+      particle_buckets_[i] = static_cast<uint32_t>(bucket);
+      bucket_start_[bucket]++;
+    }
+    // Inclusive prefix sum: bucket_start_[b] is now the end of bucket b.
+    for (size_t b = 0; b < table_size; b++) {
+      bucket_start_[b + 1] += bucket_start_[b];
+    }
+    // Scatter in reverse, moving each end down to the start of its bucket,
+    // so that each bucket lists its particles in index order.
+    for (size_t i = num_particles; i-- > 0;) {
+      sorted_[--bucket_start_[particle_buckets_[i]]] = static_cast<int>(i);
+    }
+  }
+
+  // Calls fn(index) once for every particle in a bucket of a cell that
+  // overlaps the box [lo, hi]. Callers filter the candidates by distance.
+  // Boxes spanning more cells than there are buckets visit every particle.
+  // Not const: the list of buckets to visit is kept to avoid allocating.
+  template <class F>
+  void ForEachInBox(const glm::vec3& lo, const glm::vec3& hi, const F& fn) {
+    if (sorted_.empty()) {
+      return;
+    }
+    glm::ivec3 first = GetCell(lo);
+    glm::ivec3 last = GetCell(hi);
+    glm::dvec3 extent = glm::dvec3(last - first) + 1.0;
+    if (extent.x * extent.y * extent.z > static_cast<double>(mask_ + 1)) {
+      for (int i : sorted_) {
+        fn(i);
+      }
+      return;
+    }
+    std::vector<size_t>& buckets = box_buckets_;
+    buckets.clear();
+    for (int x = first.x; x <= last.x; x++) {
+      for (int y = first.y; y <= last.y; y++) {
+        for (int z = first.z; z <= last.z; z++) {
+          buckets.push_back(GetBucket(glm::ivec3(x, y, z)));
+        }
+      }
+    }
+    // Several cells may share a bucket; visit each bucket once.
+    std::sort(buckets.begin(), buckets.end());
+    buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+    for (size_t bucket : buckets) {
+      for (int k = bucket_start_[bucket]; k < bucket_start_[bucket + 1]; k++) {
+        fn(sorted_[k]);
+      }
+    }
+  }
+
+  // Calls fn(index) once for every particle in a bucket of a cell that
+  // overlaps the box of half-size |radius| around |position|. With a radius
+  // of at most half the cell size that is at most 8 cells. Safe to call
+  // from several threads.
+  template <class F>
+  void ForEachNear(const glm::vec3& position, float radius, const F& fn) const {
+    glm::ivec3 first = GetCell(position - radius);
+    glm::ivec3 last = GetCell(position + radius);
+    size_t buckets[8];
+    int num_buckets = 0;
+    for (int x = first.x; x <= std::min(last.x, first.x + 1); x++) {
+      for (int y = first.y; y <= std::min(last.y, first.y + 1); y++) {
+        for (int z = first.z; z <= std::min(last.z, first.z + 1); z++) {
+          size_t bucket = GetBucket(glm::ivec3(x, y, z));
+          // Skip buckets already listed for another cell.
+          if (std::find(buckets, buckets + num_buckets, bucket) ==
+              buckets + num_buckets) {
+            buckets[num_buckets++] = bucket;
+          }
+        }
+      }
+    }
+    for (int b = 0; b < num_buckets; b++) {
+      for (int k = bucket_start_[buckets[b]]; k < bucket_start_[buckets[b] + 1];
+           k++) {
+        fn(sorted_[k]);
+      }
+    }
+  }
+
+  glm::ivec3 GetCell(const glm::vec3& position) const {
+    return GetCell(position, 1.0f / cell_size_);
+  }
+
+  size_t GetBucket(const glm::ivec3& cell) const {
+    uint32_t hash = (static_cast<uint32_t>(cell.x) * 92837111u) ^
+                    (static_cast<uint32_t>(cell.y) * 689287499u) ^
+                    (static_cast<uint32_t>(cell.z) * 283923481u);
+    return hash & mask_;
+  }
+
+ private:
+  // Truncation plus a correction for negative coordinates is much cheaper
+  // than std::floor without SSE4.1.
+  static glm::ivec3 GetCell(const glm::vec3& position,
+                            float inverse_cell_size) {
+    glm::vec3 scaled = position * inverse_cell_size;
+    glm::ivec3 cell(scaled);
+    return cell - glm::ivec3(glm::lessThan(scaled, glm::vec3(cell)));
+  }
+
+  float cell_size_;
+  size_t mask_ = 0;
+  std::vector<int> bucket_start_;
+  std::vector<uint32_t> particle_buckets_;
+  std::vector<int> sorted_;
+  std::vector<size_t> box_buckets_;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef SPHERE_COLLIDER_H_
+#define SPHERE_COLLIDER_H_
+
+#include <cmath>
+
+#include "Collider.hpp"
+
+namespace GLOO {
+// A sphere centered at the origin of its local frame.
+class SphereCollider : public Collider {
+ public:
+  explicit SphereCollider(float radius) : radius_(radius) {
+  }
+
+  SphereCollider(float radius, KinematicPath path)
+      : Collider(std::move(path)), radius_(radius) {
+  }
+
+  float GetRadius() const {
+    return radius_;
+  }
+
+  void GetLocalBounds(glm::vec3& lo, glm::vec3& hi) const override {
+    lo = glm::vec3(-radius_);
+    hi = glm::vec3(radius_);
+  }
+
+  bool FindContact(const glm::vec3& point,
+                   float margin,
+                   Contact& contact) const override {
+    return FindSphereContact(glm::vec3(0.0f), radius_, point, margin, contact);
+  }
+
+  // Shared with the capsule, which is a sphere swept along a segment.
+  static bool FindSphereContact(const glm::vec3& center,
+                                float radius,
+                                const glm::vec3& point,
+                                float margin,
+                                Contact& contact) {
+    glm::vec3 d = point - center;
+    float distance_squared = glm::dot(d, d);
+    float reach = radius + margin;
+    if (distance_squared >= reach * reach) {
+      return false;
+    }
+    float distance = std::sqrt(distance_squared);
+    // A particle at the very center is pushed out upward.
+    contact.normal =
+        distance > 1e-6f ? d / distance : glm::vec3(0.0f, 1.0f, 0.0f);
+    contact.position = center + reach * contact.normal;
+    return true;
+  }
+
+ private:
+  float radius_;
+};
+}  // namespace GLOO
+
+#endif
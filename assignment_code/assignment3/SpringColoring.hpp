@@ -0,0 +1,92 @@
+#ifndef SPRING_COLORING_H_
+#define SPRING_COLORING_H_
+
+#include <vector>
+
+namespace GLOO {
+// Springs grouped into conflict-free batches: no two springs within a batch
+// share a particle, so a batch can be processed in parallel and scattered into
+// per-particle buffers without atomics.
+struct SpringBatches {
+  // Spring indices, grouped by batch and in original order within a batch.
+  std::vector<int> order;
+  // Batch b covers order[offsets[b]] .. order[offsets[b + 1] - 1].
+  std::vector<size_t> offsets;
+
+  size_t GetNumBatches() const {
+    return offsets.empty() ? 0 : offsets.size() - 1;
+  }
+};
+
+// Greedy edge coloring: each spring takes the smallest color not yet used by
+// a spring sharing one of its endpoints. For a cloth grid this yields about
+// a dozen batches. TSpring needs particle1_index and particle2_index.
+template <class TSpring>
+SpringBatches ColorSprings(int num_particles,
+                           const std::vector<TSpring>& springs) {
+  int num_springs = static_cast<int>(springs.size());
+
+  // Springs incident to each particle, in CSR form.
+  std::vector<int> incident_offsets(num_particles + 1, 0);
+  for (const auto& spring : springs) {
+    incident_offsets[spring.particle1_index + 1]++;
+    incident_offsets[spring.particle2_index + 1]++;
+  }
+  for (int i = 0; i < num_particles; i++) {
+    incident_offsets[i + 1] += incident_offsets[i];
+  }
+  std::vector<int> incident(incident_offsets[num_particles]);
+  std::vector<int> cursor(incident_offsets.begin(), incident_offsets.end() - 1);
+  for (int s = 0; s < num_springs; s++) {
+    incident[cursor[springs[s].particle1_index]++] = s;
+    incident[cursor[springs[s].particle2_index]++] = s;
+  }
+
+  std::vector<int> colors(num_springs, -1);
+  // forbidden[c] == s marks color c as taken by a neighbor of spring s.
+  std::vector<int> forbidden;
+  int num_colors = 0;
+  for (int s = 0; s < num_springs; s++) {
+    int endpoints[2] = {springs[s].particle1_index,
+                        springs[s].particle2_index};
+    for (int p : endpoints) {
+      for (int k = incident_offsets[p]; k < incident_offsets[p + 1]; k++) {
+        int c = colors[incident[k]];
+        if (c >= 0) {
+          if (c >= static_cast<int>(forbidden.size())) {
+            forbidden.resize(c + 1, -1);
+          }
+          forbidden[c] = s;
+        }
+      }
+    }
+    int color = 0;
+    while (color < static_cast<int>(forbidden.size()) &&
+           forbidden[color] == s) {
+      color++;
+    }
+    colors[s] = color;
+    if (color + 1 > num_colors) {
+      num_colors = color + 1;
+    }
+  }
+
+  // Stable counting sort of the springs by color.
+  SpringBatches batches;
+  batches.offsets.assign(num_colors + 1, 0);
+  for (int s = 0; s < num_springs; s++) {
+    batches.offsets[colors[s] + 1]++;
+  }
+  for (int c = 0; c < num_colors; c++) {
+    batches.offsets[c + 1] += batches.offsets[c];
+  }
+  batches.order.resize(num_springs);
+  std::vector<size_t> fill(batches.offsets.begin(), batches.offsets.end() - 1);
+  for (int s = 0; s < num_springs; s++) {
+    batches.order[fill[colors[s]]++] = s;
+  }
+  return batches;
+}
+}  // namespace GLOO
+
+#endif
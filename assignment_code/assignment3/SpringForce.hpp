@@ -0,0 +1,143 @@
+#ifndef SPRING_FORCE_H_
+#define SPRING_FORCE_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "ForceModule.hpp"
+
+namespace GLOO {
+// Hookean forces along the springs of the system, evaluated in TForce: the
+// separation of the endpoints is taken in T, so it does not suffer from
+// cancellation, and the length and force math runs in TForce before being
+// accumulated back in T. SpringForceT<double, float> thus keeps double
+// accumulation with float force kernels.
+//
+// Serially, each spring is visited once and pushes its endpoints apart (or
+// together) with equal and opposite forces. On a pool, springs are processed
+// in conflict-free color batches. Per-particle sums are added in batch order,
+// so results are identical for any thread count (but may differ in the last
+// bit from the serial path, which adds them in spring order).
+template <class T, class TForce = T>
+class SpringForceT : public ForceModuleT<T> {
+ public:
+  typedef typename ForceModuleT<T>::State State;
+  typedef typename ForceModuleT<T>::Vec3 Vec3;
+  typedef glm::vec<3, TForce, glm::defaultp> ForceVec3;
+
+  const char* GetName() const override {
+    return "springs";
+  }
+
+  bool IsInternal() const override {
+    return true;
+  }
+
+  void AccumulateForces(const ForceContext& context,
+                        const State& state,
+                        double time,
+                        std::vector<Vec3>& forces) const override {
+    const std::vector<Spring>& springs = context.springs;
+    const SpringBatches* batches = context.spring_batches;
+    if (batches == nullptr) {
+      for (const Spring& spring : springs) {
+        AccumulateSpringForce(spring, state, forces);
+      }
+      return;
+    }
+    // Springs within a batch touch disjoint particles, so threads never
+    // write to the same force.
+    for (size_t b = 0; b < batches->GetNumBatches(); b++) {
+      const int* batch = batches->order.data() + batches->offsets[b];
+      size_t batch_size = batches->offsets[b + 1] - batches->offsets[b];
+      context.ParallelFor(batch_size, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+          AccumulateSpringForce(springs[batch[k]], state, forces);
+        }
+      });
+    }
+  }
+
+  // Analytic spring Jacobians. df_i/dx_i = df_j/dx_j = J and
+  // df_i/dx_j = df_j/dx_i = -J; springs do not depend on velocity.
+  void AddImplicitTerms(const ForceContext& context,
+                        const State& state,
+                        float dt,
+                        BlockSparseMatrix& matrix,
+                        std::vector<glm::vec3>& rhs) const override {
+    const std::vector<Particle>& particles = context.particles;
+    for (const Spring& spring : context.springs) {
+      int i = spring.particle1_index;
+      int j = spring.particle2_index;
+      bool free_i = !particles[i].fixed;
+      bool free_j = !particles[j].fixed;
+      glm::mat3 jacobian = SpringJacobian(spring, state);
+
+      glm::vec3 dv(state.velocities[i] - state.velocities[j]);
+      rhs[i] += dt * (jacobian * dv);
+      rhs[j] -= dt * (jacobian * dv);
+
+      if (free_i) {
+        matrix.AddDiagonal(i, -dt * dt * jacobian);
+      }
+      if (free_j) {
+        matrix.AddDiagonal(j, -dt * dt * jacobian);
+      }
+      if (free_i && free_j) {
+        matrix.AddOffDiagonal(i, j, dt * dt * jacobian);
+      }
+    }
+  }
+
+  T ComputePotentialEnergy(const ForceContext& context,
+                           const State& state) const override {
+    T energy = 0;
+    for (const Spring& spring : context.springs) {
+      T stretch = glm::length(state.positions[spring.particle1_index] -
+                              state.positions[spring.particle2_index]) -
+                  T(spring.rest_length);
+      energy += T(0.5) * T(spring.stiffness) * stretch * stretch;
+    }
+    return energy;
+  }
+
+ private:
+  static void AccumulateSpringForce(const Spring& spring,
+                                    const State& state,
+                                    std::vector<Vec3>& forces) {
+    int i = spring.particle1_index;
+    int j = spring.particle2_index;
+    ForceVec3 d(state.positions[i] - state.positions[j]);
+    TForce length = glm::length(d);
+
+    if (length > TForce(1e-6)) {
+      ForceVec3 direction = d / length;
+      TForce displacement = length - TForce(spring.rest_length);
+      ForceVec3 spring_force =
+          -TForce(spring.stiffness) * displacement * direction;
+      forces[i] += Vec3(spring_force);
+      forces[j] -= Vec3(spring_force);
+    }
+  }
+
+  // df_i/dx_i for the force the spring exerts on particle1. The transverse
+  // term is clamped for compressed springs to keep the matrix definite.
+  static glm::mat3 SpringJacobian(const Spring& spring, const State& state) {
+    glm::vec3 d(state.positions[spring.particle1_index] -
+                state.positions[spring.particle2_index]);
+    float length = glm::length(d);
+    if (length <= 1e-6f) {
+      return glm::mat3(0.0f);
+    }
+    glm::vec3 direction = d / length;
+    glm::mat3 projection = glm::outerProduct(direction, direction);
+    float transverse = std::max(0.0f, 1.0f - spring.rest_length / length);
+    return -spring.stiffness *
+           (projection + transverse * (glm::mat3(1.0f) - projection));
+  }
+};
+
+typedef SpringForceT<float> SpringForce;
+}  // namespace GLOO
+
+#endif
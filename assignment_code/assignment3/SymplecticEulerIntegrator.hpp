@@ -0,0 +1,44 @@
+#ifndef SYMPLECTIC_EULER_INTEGRATOR_H_
+#define SYMPLECTIC_EULER_INTEGRATOR_H_
+
+#include "IntegratorBase.hpp"
+
+namespace GLOO {
+// Semi-implicit (symplectic) Euler: kick the velocities with the current
+// acceleration, then drift the positions with the new velocities. One
+// derivative evaluation per step and far less energy drift than forward
+// Euler on mass-spring systems.
+//
+// The drift uses x' + (v1 - v0) rather than v1 directly, which equals v1 for
+// second-order systems (x' = v) and reduces to forward Euler on the positions
+// of first-order systems whose velocities stay zero.
+template <class TSystem, class TState>
+class SymplecticEulerIntegrator
+    : public StaticIntegratorBase<SymplecticEulerIntegrator<TSystem, TState>,
+                                  TSystem, TState> {
+ public:
+  void Step(const TSystem& system,
+            TState& state,
+            double start_time,
+            float dt,
+            IntegratorWorkspace<TState>& workspace) const {
+    TState& f0 = workspace.Stage(0);
+    system.ComputeTimeDerivative(state, start_time, f0);
+
+    typedef typename TState::Scalar Scalar;
+    const Scalar h = dt;
+    Scalar* x = state.FlatPositions();
+    Scalar* v = state.FlatVelocities();
+    const Scalar* dx = f0.FlatPositions();
+    const Scalar* dv = f0.FlatVelocities();
+    size_t n = state.FlatSize();
+    for (size_t j = 0; j < n; j++) {
+      Scalar kick = h * dv[j];
+      v[j] += kick;
+      x[j] += h * (dx[j] + kick);
+    }
+  }
+};
+}  // namespace GLOO
+
+#endif
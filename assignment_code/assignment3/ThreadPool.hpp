@@ -0,0 +1,126 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GLOO {
+// A fixed set of worker threads for data-parallel loops. The calling thread
+// takes part in every loop, so a pool of N threads spawns N - 1 workers.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_threads)
+      : num_threads_(num_threads < 1 ? 1 : num_threads),
+        generation_(0),
+        pending_(0),
+        stopping_(false),
+        job_(nullptr),
+        job_fn_(nullptr),
+        job_count_(0) {
+    for (int t = 1; t < num_threads_; t++) {
+      workers_.emplace_back(&ThreadPool::WorkerLoop, this, t);
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  int GetNumThreads() const {
+    return num_threads_;
+  }
+
+  // Calls fn(begin, end) on GetNumThreads() contiguous chunks of [0, count)
+  // and blocks until all of them return. Chunk boundaries depend only on
+  // |count| and the thread count. |fn| is not copied, so this does not
+  // allocate.
+  template <class F>
+  void ParallelFor(size_t count, const F& fn) {
+    if (num_threads_ == 1 || count < static_cast<size_t>(num_threads_)) {
+      fn(0, count);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = &fn;
+      job_fn_ = &Invoke<F>;
+      job_count_ = count;
+      pending_ = num_threads_ - 1;
+      generation_++;
+    }
+    start_cv_.notify_all();
+    RunChunk(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return pending_ == 0; });
+  }
+
+ private:
+  typedef void (*JobFn)(const void* job, size_t begin, size_t end);
+
+  template <class F>
+  static void Invoke(const void* job, size_t begin, size_t end) {
+    (*static_cast<const F*>(job))(begin, end);
+  }
+
+  void RunChunk(int t) {
+    size_t begin = job_count_ * t / num_threads_;
+    size_t end = job_count_ * (t + 1) / num_threads_;
+    if (begin < end) {
+      job_fn_(job_, begin, end);
+    }
+  }
+
+  void WorkerLoop(int t) {
+    size_t seen_generation = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_cv_.wait(lock, [this, seen_generation] {
+          return stopping_ || generation_ != seen_generation;
+        });
+        if (stopping_) {
+          return;
+        }
+        seen_generation = generation_;
+      }
+      RunChunk(t);
+      bool last;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        last = --pending_ == 0;
+      }
+      if (last) {
+        done_cv_.notify_one();
+      }
+    }
+  }
+
+  int num_threads_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  size_t generation_;
+  int pending_;
+  bool stopping_;
+
+  const void* job_;
+  JobFn job_fn_;
+  size_t job_count_;
+};
+}  // namespace GLOO
+
+#endif
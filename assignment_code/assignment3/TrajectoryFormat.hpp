@@ -0,0 +1,68 @@
+#ifndef TRAJECTORY_FORMAT_H_
+#define TRAJECTORY_FORMAT_H_
+
+#include <cstdint>
+#include <cstring>
+
+#include "PendulumSystem.hpp"
+
+namespace GLOO {
+// Binary trajectory files: a 64-byte header followed by fixed-size frames.
+// Frame k holds the float positions of all particles (3 * num_particles
+// floats, directly usable as glm::vec3s) at time start_time + k * dt,
+// followed by the velocities if kTrajectoryHasVelocities is set. Values are
+// stored in native byte order.
+const char kTrajectoryMagic[8] = {'G', 'L', 'O', 'O', 'T', 'R', 'A', 'J'};
+const uint32_t kTrajectoryVersion = 1;
+const uint32_t kTrajectoryHasVelocities = 1;
+
+struct TrajectoryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_particles;
+  uint32_t flags;
+  uint32_t reserved;
+  double start_time;
+  double dt;
+  // ComputeTopologyHash() of the recorded system, to catch replays against
+  // a different mesh.
+  uint64_t topology_hash;
+  // Frames the file has room for, and frames written so far.
+  uint64_t capacity;
+  uint64_t num_frames;
+};
+static_assert(sizeof(TrajectoryHeader) == 64,
+              "Trajectory header must stay 64 bytes.");
+
+inline size_t GetTrajectoryFrameSize(uint32_t num_particles, uint32_t flags) {
+  size_t vectors = (flags & kTrajectoryHasVelocities) != 0 ? 2 : 1;
+  return vectors * num_particles * sizeof(glm::vec3);
+}
+
+// FNV-1a over what determines the meaning of recorded positions: the number
+// of particles, which are fixed, and the spring endpoints and rest lengths.
+template <class T, class TForce>
+uint64_t ComputeTopologyHash(const PendulumSystemT<T, TForce>& system) {
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](const void* data, size_t num_bytes) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t b = 0; b < num_bytes; b++) {
+      hash = (hash ^ bytes[b]) * 1099511628211ull;
+    }
+  };
+  uint64_t num_particles = system.GetNumParticles();
+  mix(&num_particles, sizeof(num_particles));
+  for (const Particle& particle : system.GetParticles()) {
+    unsigned char fixed = particle.fixed ? 1 : 0;
+    mix(&fixed, 1);
+  }
+  for (const Spring& spring : system.GetSprings()) {
+    mix(&spring.particle1_index, sizeof(spring.particle1_index));
+    mix(&spring.particle2_index, sizeof(spring.particle2_index));
+    mix(&spring.rest_length, sizeof(spring.rest_length));
+  }
+  return hash;
+}
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef TRAJECTORY_READER_H_
+#define TRAJECTORY_READER_H_
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.hpp"
+#include "TrajectoryFormat.hpp"
+
+namespace GLOO {
+// Read-only view of a trajectory file. Frames are returned as pointers into
+// the mapping; nothing is copied, and pages are only read from disk when a
+// frame is first touched.
+class TrajectoryReader {
+ public:
+  explicit TrajectoryReader(const std::string& path) : file_(path) {
+    if (file_.GetSize() < sizeof(TrajectoryHeader)) {
+      throw std::runtime_error("Not a trajectory file: " + path);
+    }
+    std::memcpy(&header_, file_.GetData(), sizeof(TrajectoryHeader));
+    if (std::memcmp(header_.magic, kTrajectoryMagic, sizeof(header_.magic)) !=
+            0 ||
+        header_.version != kTrajectoryVersion) {
+      throw std::runtime_error("Not a trajectory file: " + path);
+    }
+    frame_size_ = GetTrajectoryFrameSize(header_.num_particles, header_.flags);
+    if (frame_size_ == 0) {
+      throw std::runtime_error("Trajectory file has no particles: " + path);
+    }
+    // A recording that was not closed keeps its full capacity on disk.
+    uint64_t available =
+        (file_.GetSize() - sizeof(TrajectoryHeader)) / frame_size_;
+    if (header_.num_frames > available) {
+      throw std::runtime_error("Truncated trajectory file: " + path);
+    }
+  }
+
+  uint32_t GetNumParticles() const {
+    return header_.num_particles;
+  }
+  uint64_t GetNumFrames() const {
+    return header_.num_frames;
+  }
+  double GetStartTime() const {
+    return header_.start_time;
+  }
+  double GetTimeStep() const {
+    return header_.dt;
+  }
+  uint64_t GetTopologyHash() const {
+    return header_.topology_hash;
+  }
+  bool HasVelocities() const {
+    return (header_.flags & kTrajectoryHasVelocities) != 0;
+  }
+
+  const glm::vec3* GetPositions(uint64_t frame) const {
+    return reinterpret_cast<const glm::vec3*>(GetFrame(frame));
+  }
+
+  // nullptr if velocities were not recorded.
+  const glm::vec3* GetVelocities(uint64_t frame) const {
+    if (!HasVelocities()) {
+      return nullptr;
+    }
+    return GetPositions(frame) + header_.num_particles;
+  }
+
+ private:
+  const char* GetFrame(uint64_t frame) const {
+    if (frame >= header_.num_frames) {
+      throw std::runtime_error("Trajectory frame out of range!");
+    }
+    return file_.GetData() + sizeof(TrajectoryHeader) + frame * frame_size_;
+  }
+
+  MappedFile file_;
+  TrajectoryHeader header_;
+  size_t frame_size_;
+};
+}  // namespace GLOO
+
+#endif
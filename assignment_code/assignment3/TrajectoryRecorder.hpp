@@ -0,0 +1,97 @@
+#ifndef TRAJECTORY_RECORDER_H_
+#define TRAJECTORY_RECORDER_H_
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "MappedFile.hpp"
+#include "ParticleState.hpp"
+#include "TrajectoryFormat.hpp"
+
+namespace GLOO {
+// Streams states into a trajectory file (see TrajectoryFormat.hpp) that is
+// allocated for |capacity| frames up front and memory mapped, so recording
+// a frame is a memcpy with no system calls. Frames are assumed to be |dt|
+// apart. Close() (or destruction) cuts the file to the frames written.
+class TrajectoryRecorder {
+ public:
+  TrajectoryRecorder(const std::string& path,
+                     uint32_t num_particles,
+                     double start_time,
+                     double dt,
+                     uint64_t topology_hash,
+                     uint64_t capacity,
+                     bool record_velocities = false)
+      : flags_(record_velocities ? kTrajectoryHasVelocities : 0),
+        frame_size_(GetTrajectoryFrameSize(num_particles, flags_)),
+        file_(new MappedFile(
+            path, sizeof(TrajectoryHeader) + capacity * frame_size_)) {
+    TrajectoryHeader* header = GetHeader();
+    std::memset(header, 0, sizeof(TrajectoryHeader));
+    std::memcpy(header->magic, kTrajectoryMagic, sizeof(header->magic));
+    header->version = kTrajectoryVersion;
+    header->num_particles = num_particles;
+    header->flags = flags_;
+    header->start_time = start_time;
+    header->dt = dt;
+    header->topology_hash = topology_hash;
+    header->capacity = capacity;
+    header->num_frames = 0;
+  }
+
+  ~TrajectoryRecorder() {
+    Close();
+  }
+
+  // Appends |state| as the next frame. Returns false once the file is full
+  // or closed.
+  bool Record(const ParticleState& state) {
+    if (file_ == nullptr) {
+      return false;
+    }
+    TrajectoryHeader* header = GetHeader();
+    if (header->num_frames == header->capacity) {
+      return false;
+    }
+    if (state.positions.size() != header->num_particles) {
+      throw std::runtime_error("Recorded state has the wrong particle count!");
+    }
+    char* frame = file_->GetData() + sizeof(TrajectoryHeader) +
+                  header->num_frames * frame_size_;
+    size_t vector_bytes = header->num_particles * sizeof(glm::vec3);
+    std::memcpy(frame, state.positions.data(), vector_bytes);
+    if ((flags_ & kTrajectoryHasVelocities) != 0) {
+      std::memcpy(frame + vector_bytes, state.velocities.data(), vector_bytes);
+    }
+    header->num_frames++;
+    return true;
+  }
+
+  uint64_t GetNumFrames() const {
+    return file_ == nullptr ? 0 : GetHeader()->num_frames;
+  }
+
+  void Close() {
+    if (file_ == nullptr) {
+      return;
+    }
+    TrajectoryHeader* header = GetHeader();
+    header->capacity = header->num_frames;
+    file_->Close(sizeof(TrajectoryHeader) + header->num_frames * frame_size_);
+    file_.reset();
+  }
+
+ private:
+  TrajectoryHeader* GetHeader() const {
+    return reinterpret_cast<TrajectoryHeader*>(file_->GetData());
+  }
+
+  uint32_t flags_;
+  size_t frame_size_;
+  std::unique_ptr<MappedFile> file_;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef TRAJECTORY_REPLAY_NODE_H_
+#define TRAJECTORY_REPLAY_NODE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "gloo/SceneNode.hpp"
+#include "gloo/InputManager.hpp"
+#include "gloo/VertexObject.hpp"
+#include "gloo/components/RenderingComponent.hpp"
+#include "gloo/components/ShadingComponent.hpp"
+#include "gloo/shaders/SimpleShader.hpp"
+
+#include "PendulumSystem.hpp"
+#include "TrajectoryReader.hpp"
+
+namespace GLOO {
+// Plays back a recorded trajectory as lines between particles, looping at
+// the end. Each frame is uploaded to the GPU straight from the memory-mapped
+// file, so playback copies nothing on the CPU. Press 'R' to restart.
+class TrajectoryReplayNode : public SceneNode {
+ public:
+  // |edges| holds pairs of particle indices to connect.
+  TrajectoryReplayNode(std::shared_ptr<const TrajectoryReader> reader,
+                       std::unique_ptr<IndexArray> edges)
+      : reader_(std::move(reader)),
+        playback_rate_(1.0),
+        time_(0.0),
+        shown_frame_(0) {
+    if (reader_->GetNumFrames() == 0) {
+      throw std::runtime_error("Cannot replay an empty trajectory!");
+    }
+    size_t num_particles = reader_->GetNumParticles();
+    // The vertex object needs one CPU array to size its buffer; every later
+    // frame is streamed.
+    const glm::vec3* first = reader_->GetPositions(0);
+    auto positions = make_unique<PositionArray>(first, first + num_particles);
+    auto vertex_obj = make_unique<VertexObject>();
+    vertex_obj->UpdatePositions(std::move(positions));
+    vertex_obj->UpdateIndices(std::move(edges));
+    vertex_object_ = vertex_obj.get();
+
+    auto& rc = CreateComponent<RenderingComponent>(std::move(vertex_obj));
+    rc.SetDrawMode(DrawMode::Lines);
+    CreateComponent<ShadingComponent>(std::make_shared<SimpleShader>());
+  }
+
+  // Edges along every spring of |system|.
+  static std::unique_ptr<IndexArray> MakeSpringEdges(
+      const PendulumSystem& system) {
+    auto edges = make_unique<IndexArray>();
+    for (const Spring& spring : system.GetSprings()) {
+      edges->push_back(static_cast<unsigned int>(spring.particle1_index));
+      edges->push_back(static_cast<unsigned int>(spring.particle2_index));
+    }
+    return edges;
+  }
+
+  // Structural edges of a row-major grid_size x grid_size cloth, as drawn
+  // by ClothNode.
+  static std::unique_ptr<IndexArray> MakeGridEdges(int grid_size) {
+    auto edges = make_unique<IndexArray>();
+    for (int i = 0; i < grid_size; i++) {
+      for (int j = 0; j < grid_size; j++) {
+        unsigned int index = i * grid_size + j;
+        if (j < grid_size - 1) {
+          edges->push_back(index);
+          edges->push_back(index + 1);
+        }
+        if (i < grid_size - 1) {
+          edges->push_back(index);
+          edges->push_back(index + grid_size);
+        }
+      }
+    }
+    return edges;
+  }
+
+  // Recorded seconds played per real second; 0 pauses.
+  void SetPlaybackRate(double rate) {
+    playback_rate_ = rate;
+  }
+
+  // Jumps to |time| seconds after the start of the recording.
+  void Seek(double time) {
+    double duration = reader_->GetNumFrames() * reader_->GetTimeStep();
+    time_ = duration > 0.0 ? std::fmod(std::max(time, 0.0), duration) : 0.0;
+    ShowFrame(FrameAt(time_));
+  }
+
+  void Update(double delta_time) override {
+    if (InputManager::GetInstance().IsKeyPressed('R')) {
+      Seek(0.0);
+      return;
+    }
+    Seek(time_ + delta_time * playback_rate_);
+  }
+
+ private:
+  uint64_t FrameAt(double time) const {
+    double dt = reader_->GetTimeStep();
+    uint64_t frame = dt > 0.0 ? static_cast<uint64_t>(time / dt) : 0;
+    return std::min(frame, reader_->GetNumFrames() - 1);
+  }
+
+  void ShowFrame(uint64_t frame) {
+    if (frame == shown_frame_) {
+      return;
+    }
+    vertex_object_->StreamPositions(reader_->GetPositions(frame),
+                                    reader_->GetNumParticles());
+    shown_frame_ = frame;
+  }
+
+  std::shared_ptr<const TrajectoryReader> reader_;
+  VertexObject* vertex_object_;
+  double playback_rate_;
+  double time_;
+  uint64_t shown_frame_;
+};
+}  // namespace GLOO
+
+#endif
@@ -5,18 +5,27 @@
 
 namespace GLOO {
 template <class TSystem, class TState>
-class TrapezoidalIntegrator : public IntegratorBase<TSystem, TState> {
-    TState Integrate(const TSystem& system,
-                    const TState& state, 
-                    float start_time,
-                    float dt) const override {
+class TrapezoidalIntegrator
+    : public StaticIntegratorBase<TrapezoidalIntegrator<TSystem, TState>,
+                                  TSystem, TState> {
+public:
+    void Step(const TSystem& system,
+              TState& state,
+              double start_time,
+              float dt,
+              IntegratorWorkspace<TState>& workspace) const {
         // Trapezoidal Rule
-        TState f0 = system.ComputeTimeDerivative(state, start_time);
-        TState temp_state = state + f0 * dt;
-        TState f1 = system.ComputeTimeDerivative(temp_state, start_time + dt);
-        return state + (f0 + f1) * (dt / 2.0f);
+        typedef typename TState::Scalar Scalar;
+        const Scalar h = dt;
+        TState& f0 = workspace.Stage(0);
+        TState& f1 = workspace.Stage(1);
+        TState& temp_state = workspace.temp;
+        system.ComputeTimeDerivative(state, start_time, f0);
+        temp_state = state + f0 * h;
+        system.ComputeTimeDerivative(temp_state, start_time + dt, f1);
+        state = state + (f0 + f1) * (h / 2);
     }
 };
 } // namespace GLOO
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,357 @@
+#ifndef TRIANGLE_BVH_H_
+#define TRIANGLE_BVH_H_
+
+#include <algorithm>
+#include <cfloat>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace GLOO {
+// Part of a triangle that a closest point lies on.
+enum class TriangleFeature { Vertex0, Vertex1, Vertex2, Edge01, Edge12, Edge20, Face };
+
+struct ClosestTriangleHit {
+  glm::vec3 point;
+  float distance_squared;
+  // Index of the triangle in the mesh the tree was built from.
+  int triangle;
+  TriangleFeature feature;
+};
+
+// Closest point on triangle abc to |p|, after Ericson, "Real-Time Collision
+// Detection", 5.1.5, also reporting which feature it lies on.
+inline glm::vec3 ClosestPointOnTriangle(const glm::vec3& p,
+                                        const glm::vec3& a,
+                                        const glm::vec3& b,
+                                        const glm::vec3& c,
+                                        TriangleFeature& feature) {
+  glm::vec3 ab = b - a;
+  glm::vec3 ac = c - a;
+  glm::vec3 ap = p - a;
+  float d1 = glm::dot(ab, ap);
+  float d2 = glm::dot(ac, ap);
+  if (d1 <= 0.0f && d2 <= 0.0f) {
+    feature = TriangleFeature::Vertex0;
+    return a;
+  }
+  glm::vec3 bp = p - b;
+  float d3 = glm::dot(ab, bp);
+  float d4 = glm::dot(ac, bp);
+  if (d3 >= 0.0f && d4 <= d3) {
+    feature = TriangleFeature::Vertex1;
+    return b;
+  }
+  float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+    feature = TriangleFeature::Edge01;
+    return a + d1 / (d1 - d3) * ab;
+  }
+  glm::vec3 cp = p - c;
+  float d5 = glm::dot(ab, cp);
+  float d6 = glm::dot(ac, cp);
+  if (d6 >= 0.0f && d5 <= d6) {
+    feature = TriangleFeature::Vertex2;
+    return c;
+  }
+  float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+    feature = TriangleFeature::Edge20;
+    return a + d2 / (d2 - d6) * ac;
+  }
+  float va = d3 * d6 - d5 * d4;
+  if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+    feature = TriangleFeature::Edge12;
+    return b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+  }
+  float denominator = 1.0f / (va + vb + vc);
+  feature = TriangleFeature::Face;
+  return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+// Bounding volume hierarchy over a static triangle mesh, built once with the
+// surface area heuristic evaluated on binned centroids. Nodes and triangle
+// corners are stored in traversal order in flat arrays, so queries walk
+// contiguous memory and never allocate. Queries are const and may run from
+// several threads at once.
+class TriangleBvh {
+ public:
+  // |indices| holds three vertex indices per triangle.
+  TriangleBvh(const std::vector<glm::vec3>& positions,
+              const std::vector<unsigned int>& indices) {
+    if (indices.empty() || indices.size() % 3 != 0) {
+      throw std::runtime_error("BVH needs a non-empty triangle list!");
+    }
+    size_t num_triangles = indices.size() / 3;
+    std::vector<BuildTriangle> triangles(num_triangles);
+    for (size_t t = 0; t < num_triangles; t++) {
+      BuildTriangle& triangle = triangles[t];
+      triangle.index = static_cast<int>(t);
+      triangle.lo = glm::vec3(FLT_MAX);
+      triangle.hi = glm::vec3(-FLT_MAX);
+      for (int k = 0; k < 3; k++) {
+        unsigned int vertex = indices[3 * t + k];
+        if (vertex >= positions.size()) {
+          throw std::runtime_error("Triangle index out of range!");
+        }
+        triangle.lo = glm::min(triangle.lo, positions[vertex]);
+        triangle.hi = glm::max(triangle.hi, positions[vertex]);
+      }
+      triangle.centroid = 0.5f * (triangle.lo + triangle.hi);
+    }
+
+    nodes_.reserve(2 * num_triangles);
+    nodes_.emplace_back();
+    BuildNode(0, triangles, 0, num_triangles, 0);
+
+    corners_.resize(3 * num_triangles);
+    triangle_indices_.resize(num_triangles);
+    for (size_t t = 0; t < num_triangles; t++) {
+      int index = triangles[t].index;
+      triangle_indices_[t] = index;
+      for (int k = 0; k < 3; k++) {
+        corners_[3 * t + k] = positions[indices[3 * index + k]];
+      }
+    }
+  }
+
+  size_t GetNumNodes() const {
+    return nodes_.size();
+  }
+
+  void GetBounds(glm::vec3& lo, glm::vec3& hi) const {
+    lo = nodes_[0].lo;
+    hi = nodes_[0].hi;
+  }
+
+  // Finds the closest point on the mesh to |point| among those closer than
+  // |max_distance|. Returns false if there is none.
+  bool FindClosest(const glm::vec3& point,
+                   float max_distance,
+                   ClosestTriangleHit& hit) const {
+    float best = max_distance * max_distance;
+    bool found = false;
+    // Nodes still to visit, with the squared distance to their box.
+    struct Entry {
+      int node;
+      float distance_squared;
+    };
+    Entry stack[kMaxStackSize];
+    int stack_size = 0;
+    float root_distance = BoxDistanceSquared(nodes_[0], point);
+    if (root_distance < best) {
+      stack[stack_size++] = Entry{0, root_distance};
+    }
+    while (stack_size > 0) {
+      const Entry& entry = stack[--stack_size];
+      // The best distance may have shrunk since the node was pushed.
+      if (entry.distance_squared >= best) {
+        continue;
+      }
+      const Node& node = nodes_[entry.node];
+      if (node.count > 0) {
+        for (int t = node.first; t < node.first + node.count; t++) {
+          TriangleFeature feature;
+          glm::vec3 q = ClosestPointOnTriangle(point, corners_[3 * t],
+                                               corners_[3 * t + 1],
+                                               corners_[3 * t + 2], feature);
+          glm::vec3 d = point - q;
+          float distance_squared = glm::dot(d, d);
+          if (distance_squared < best) {
+            best = distance_squared;
+            found = true;
+            hit.point = q;
+            hit.distance_squared = distance_squared;
+            hit.triangle = triangle_indices_[t];
+            hit.feature = feature;
+          }
+        }
+        continue;
+      }
+      // Visit the nearer child first; it is pushed last.
+      int near = node.first;
+      int far = node.first + 1;
+      float near_distance = BoxDistanceSquared(nodes_[near], point);
+      float far_distance = BoxDistanceSquared(nodes_[far], point);
+      if (far_distance < near_distance) {
+        std::swap(near, far);
+        std::swap(near_distance, far_distance);
+      }
+      if (far_distance < best) {
+        stack[stack_size++] = Entry{far, far_distance};
+      }
+      if (near_distance < best) {
+        stack[stack_size++] = Entry{near, near_distance};
+      }
+    }
+    return found;
+  }
+
+ private:
+  // Leaves have count > 0 triangles starting at |first|; inner nodes have
+  // their two children at |first| and |first| + 1.
+  struct Node {
+    glm::vec3 lo;
+    int first;
+    glm::vec3 hi;
+    int count;
+  };
+
+  struct BuildTriangle {
+    glm::vec3 lo;
+    glm::vec3 hi;
+    glm::vec3 centroid;
+    int index;
+  };
+
+  struct Bin {
+    glm::vec3 lo = glm::vec3(FLT_MAX);
+    glm::vec3 hi = glm::vec3(-FLT_MAX);
+    int count = 0;
+  };
+
+  static const int kNumBins = 16;
+  static const int kMaxLeafSize = 4;
+  // Below this depth nodes are split at the median, which bounds the depth,
+  // and thus the traversal stack, by kMedianSplitDepth + log2(triangles).
+  static const int kMedianSplitDepth = 32;
+  static const int kMaxStackSize = 64;
+
+  static float HalfArea(const glm::vec3& lo, const glm::vec3& hi) {
+    glm::vec3 e = glm::max(hi - lo, glm::vec3(0.0f));
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+  }
+
+  static float BoxDistanceSquared(const Node& node, const glm::vec3& p) {
+    glm::vec3 d = glm::max(glm::max(node.lo - p, p - node.hi), glm::vec3(0.0f));
+    return glm::dot(d, d);
+  }
+
+  void BuildNode(int node_index,
+                 std::vector<BuildTriangle>& triangles,
+                 size_t begin,
+                 size_t end,
+                 int depth) {
+    glm::vec3 lo(FLT_MAX);
+    glm::vec3 hi(-FLT_MAX);
+    glm::vec3 centroid_lo(FLT_MAX);
+    glm::vec3 centroid_hi(-FLT_MAX);
+    for (size_t t = begin; t < end; t++) {
+      lo = glm::min(lo, triangles[t].lo);
+      hi = glm::max(hi, triangles[t].hi);
+      centroid_lo = glm::min(centroid_lo, triangles[t].centroid);
+      centroid_hi = glm::max(centroid_hi, triangles[t].centroid);
+    }
+    nodes_[node_index].lo = lo;
+    nodes_[node_index].hi = hi;
+    int count = static_cast<int>(end - begin);
+
+    // Binned SAH: cost of a split is A_left * N_left + A_right * N_right,
+    // against A * N for keeping a leaf.
+    int best_axis = -1;
+    int best_split = 0;
+    float best_cost = FLT_MAX;
+    glm::vec3 extent = centroid_hi - centroid_lo;
+    for (int axis = 0;
+         count > kMaxLeafSize && depth < kMedianSplitDepth && axis < 3;
+         axis++) {
+      if (extent[axis] <= 0.0f) {
+        continue;
+      }
+      Bin bins[kNumBins];
+      float scale = kNumBins / extent[axis];
+      for (size_t t = begin; t < end; t++) {
+        Bin& bin = bins[BinIndex(triangles[t].centroid[axis],
+                                 centroid_lo[axis], scale)];
+        bin.lo = glm::min(bin.lo, triangles[t].lo);
+        bin.hi = glm::max(bin.hi, triangles[t].hi);
+        bin.count++;
+      }
+      // Costs of the left sides, then sweep from the right.
+      float left_cost[kNumBins - 1];
+      Bin left;
+      for (int b = 0; b < kNumBins - 1; b++) {
+        left.lo = glm::min(left.lo, bins[b].lo);
+        left.hi = glm::max(left.hi, bins[b].hi);
+        left.count += bins[b].count;
+        left_cost[b] = left.count > 0 ? HalfArea(left.lo, left.hi) * left.count
+                                      : 0.0f;
+      }
+      Bin right;
+      for (int b = kNumBins - 1; b > 0; b--) {
+        right.lo = glm::min(right.lo, bins[b].lo);
+        right.hi = glm::max(right.hi, bins[b].hi);
+        right.count += bins[b].count;
+        float cost = left_cost[b - 1] +
+                     (right.count > 0
+                          ? HalfArea(right.lo, right.hi) * right.count
+                          : 0.0f);
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_axis = axis;
+          best_split = b;
+        }
+      }
+    }
+
+    bool split = best_axis >= 0 && best_cost < HalfArea(lo, hi) * count;
+    if (count > 4 * kMaxLeafSize || depth >= kMedianSplitDepth) {
+      split = true;
+    }
+    if (!split || count <= kMaxLeafSize) {
+      nodes_[node_index].first = static_cast<int>(begin);
+      nodes_[node_index].count = count;
+      return;
+    }
+
+    size_t middle;
+    if (best_axis >= 0) {
+      float scale = kNumBins / extent[best_axis];
+      float axis_lo = centroid_lo[best_axis];
+      middle = std::partition(triangles.begin() + begin,
+                              triangles.begin() + end,
+                              [&](const BuildTriangle& triangle) {
+                                return BinIndex(triangle.centroid[best_axis],
+                                                axis_lo, scale) < best_split;
+                              }) -
+               triangles.begin();
+    } else {
+      middle = begin;
+    }
+    // Identical centroids cannot be binned apart, and deep nodes are not
+    // binned at all; split the list in half.
+    if (middle == begin || middle == end) {
+      middle = begin + count / 2;
+      int axis = extent.x >= extent.y && extent.x >= extent.z
+                     ? 0
+                     : (extent.y >= extent.z ? 1 : 2);
+      std::nth_element(triangles.begin() + begin, triangles.begin() + middle,
+                       triangles.begin() + end,
+                       [axis](const BuildTriangle& a, const BuildTriangle& b) {
+                         return a.centroid[axis] < b.centroid[axis];
+                       });
+    }
+
+    int left = static_cast<int>(nodes_.size());
+    nodes_[node_index].first = left;
+    nodes_[node_index].count = 0;
+    nodes_.emplace_back();
+    nodes_.emplace_back();
+    BuildNode(left, triangles, begin, middle, depth + 1);
+    BuildNode(left + 1, triangles, middle, end, depth + 1);
+  }
+
+  static int BinIndex(float value, float lo, float scale) {
+    int bin = static_cast<int>((value - lo) * scale);
+    return std::min(kNumBins - 1, std::max(0, bin));
+  }
+
+  std::vector<Node> nodes_;
+  // Triangle corners and original triangle indices, in leaf order.
+  std::vector<glm::vec3> corners_;
+  std::vector<int> triangle_indices_;
+};
+}  // namespace GLOO
+
+#endif
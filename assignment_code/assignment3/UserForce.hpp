@@ -0,0 +1,49 @@
+#ifndef USER_FORCE_H_
+#define USER_FORCE_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ForceModule.hpp"
+
+namespace GLOO {
+// A scene-specific force given as a kernel over the whole state, for forces
+// that do not deserve a module of their own. The kernel adds to the forces
+// like any module and runs on the calling thread; it may use
+// context.ParallelFor() itself.
+template <class T>
+class UserForceT : public ForceModuleT<T> {
+ public:
+  typedef typename ForceModuleT<T>::State State;
+  typedef typename ForceModuleT<T>::Vec3 Vec3;
+  typedef std::function<void(const ForceContext& context,
+                             const State& state,
+                             double time,
+                             std::vector<Vec3>& forces)>
+      Kernel;
+
+  UserForceT(std::string name, Kernel kernel)
+      : name_(std::move(name)), kernel_(std::move(kernel)) {
+  }
+
+  const char* GetName() const override {
+    return name_.c_str();
+  }
+
+  void AccumulateForces(const ForceContext& context,
+                        const State& state,
+                        double time,
+                        std::vector<Vec3>& forces) const override {
+    kernel_(context, state, time, forces);
+  }
+
+ private:
+  std::string name_;
+  Kernel kernel_;
+};
+
+typedef UserForceT<float> UserForce;
+}  // namespace GLOO
+
+#endif
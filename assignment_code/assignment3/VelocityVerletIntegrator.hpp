@@ -0,0 +1,64 @@
+#ifndef VELOCITY_VERLET_INTEGRATOR_H_
+#define VELOCITY_VERLET_INTEGRATOR_H_
+
+#include <utility>
+
+#include "IntegratorBase.hpp"
+
+namespace GLOO {
+// Velocity Verlet (kick-drift-kick). Second order and time reversible for
+// position-dependent forces. The acceleration at the end of a step is the
+// one at the start of the next, so it is cached in the workspace and each
+// step costs one derivative evaluation. Velocity-dependent forces such as
+// drag are evaluated at the half-step velocity.
+template <class TSystem, class TState>
+class VelocityVerletIntegrator
+    : public StaticIntegratorBase<VelocityVerletIntegrator<TSystem, TState>,
+                                  TSystem, TState> {
+ public:
+  void Step(const TSystem& system,
+            TState& state,
+            double start_time,
+            float dt,
+            IntegratorWorkspace<TState>& workspace) const {
+    TState& f0 = workspace.Stage(0);
+    TState& f1 = workspace.Stage(1);
+    if (!workspace.first_same_as_last) {
+      system.ComputeTimeDerivative(state, start_time, f0);
+    }
+
+    typedef typename TState::Scalar Scalar;
+    const Scalar h = dt;
+    Scalar* x = state.FlatPositions();
+    Scalar* v = state.FlatVelocities();
+    size_t n = state.FlatSize();
+    {
+      const Scalar* dx = f0.FlatPositions();
+      const Scalar* dv = f0.FlatVelocities();
+      for (size_t j = 0; j < n; j++) {
+        Scalar half_kick = Scalar(0.5) * h * dv[j];
+        v[j] += half_kick;
+        x[j] += h * (dx[j] + half_kick);
+      }
+    }
+
+    system.ComputeTimeDerivative(state, start_time + dt, f1);
+
+    // Second half kick. f1 was evaluated at the half-step velocity, so its
+    // x' (= v for second-order systems) is moved along with v to stay valid
+    // as the next step's starting derivative.
+    Scalar* dx = f1.FlatPositions();
+    const Scalar* dv = f1.FlatVelocities();
+    for (size_t j = 0; j < n; j++) {
+      Scalar half_kick = Scalar(0.5) * h * dv[j];
+      v[j] += half_kick;
+      dx[j] += half_kick;
+    }
+
+    std::swap(f0, f1);
+    workspace.first_same_as_last = true;
+  }
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,418 @@
+#ifndef WIND_FIELD_H_
+#define WIND_FIELD_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "SimdKernels.hpp"
+#include "ThreadPool.hpp"
+
+namespace GLOO {
+// A time-varying wind: a mean velocity plus gusts given by curl noise, the
+// curl of a vector potential made of octaves of Perlin noise. Curl noise
+// is divergence free, so the gusts swirl around like real turbulence
+// instead of blowing out of sources. The pattern is carried along by the
+// mean wind and slowly drifts through the noise to evolve over time.
+//
+// Evaluating the noise costs a few hundred nanoseconds per point. With the
+// grid cache on, the field is instead baked on a coarse grid that moves with
+// the mean wind, at the two ends of a refresh interval. In that frame the
+// pattern only changes through the slow drift, so the slices can be far
+// apart in time. They are blended into one grid whenever the sample time
+// changes, and each sample is a trilinear lookup in it. All RK4 stages of a
+// step thus share the same two slices, and the middle stages one blend.
+class WindField {
+ public:
+  // Gusts of about |gust_speed| vary over |length_scale|.
+  WindField(const glm::vec3& mean_velocity,
+            float gust_speed,
+            float length_scale,
+            int num_octaves = 3,
+            float evolution_rate = 0.3f,
+            uint32_t seed = 1)
+      : mean_velocity_(mean_velocity),
+        inverse_length_scale_(1.0f / length_scale),
+        num_octaves_(num_octaves),
+        evolution_rate_(evolution_rate),
+        cell_size_(0.0f),
+        refresh_interval_(0.0) {
+    // Ken Perlin's permutation, shuffled by a linear congruential generator.
+    for (int i = 0; i < 256; i++) {
+      permutation_[i] = static_cast<uint8_t>(i);
+    }
+    uint32_t state = seed;
+    for (int i = 255; i > 0; i--) {
+      state = state * 1664525u + 1013904223u;
+      std::swap(permutation_[i], permutation_[(state >> 8) % (i + 1)]);
+    }
+    for (int i = 0; i < 256; i++) {
+      permutation_[i + 256] = permutation_[i];
+    }
+    // The curl of a single octave is about 1.45 long on average, and the
+    // octaves are roughly independent.
+    float sum_of_squares = 0.0f;
+    for (int octave = 0; octave < num_octaves; octave++) {
+      sum_of_squares += std::pow(0.25f, static_cast<float>(octave));
+    }
+    gust_scale_ = gust_speed / (1.45f * std::sqrt(sum_of_squares));
+  }
+
+  const glm::vec3& GetMeanVelocity() const {
+    return mean_velocity_;
+  }
+
+  // Bakes the field every |refresh_interval| seconds on a grid of
+  // |cell_size|; a cell size of 0 evaluates the noise at every sample.
+  void SetGridCache(float cell_size, double refresh_interval) {
+    cell_size_ = cell_size;
+    refresh_interval_ = refresh_interval;
+    inverse_cell_size_ = cell_size > 0.0f ? 1.0f / cell_size : 0.0f;
+    box_ = Box();
+    slices_[0].key = slices_[1].key = kNoSlice;
+    blended_key_ = kNoSlice;
+    has_samples_ = false;
+  }
+
+  bool HasGridCache() const {
+    return cell_size_ > 0.0f && refresh_interval_ > 0.0;
+  }
+
+  // Exact wind velocity at |point| and |time|.
+  glm::vec3 Evaluate(const glm::vec3& point, double time) const {
+    return EvaluateCarried(point - mean_velocity_ * static_cast<float>(time),
+                           time);
+  }
+
+  // Wind velocities at all of |positions| at |time|, computed on |pool| if
+  // given and valid until the next call. Not thread safe.
+  //
+  // With the grid cache on, bakes slices when |time| leaves their interval,
+  // and moves the grid when a position leaves it. A call at the time of the
+  // previous one, for as many positions, returns the previous samples: the
+  // RK4 stages that share a time, and the first stage of the next step,
+  // move the particles far less than a cell from where they were sampled.
+  template <class TVec>
+  const std::vector<glm::vec3>& Sample(const std::vector<TVec>& positions,
+                                       double time,
+                                       ThreadPool* pool = nullptr) {
+    size_t num_points = positions.size();
+    std::vector<glm::vec3>& velocities = samples_;
+    if (!HasGridCache()) {
+      velocities.resize(num_points);
+      ParallelFor(pool, num_points, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          velocities[i] = Evaluate(glm::vec3(positions[i]), time);
+        }
+      });
+      return velocities;
+    }
+    if (has_samples_ && time == sample_time_ &&
+        velocities.size() == num_points) {
+      return velocities;
+    }
+    velocities.resize(num_points);
+    has_samples_ = num_points > 0;
+    sample_time_ = time;
+    if (num_points == 0) {
+      return velocities;
+    }
+    // Positions in the frame carried by the mean wind.
+    glm::vec3 shift = mean_velocity_ * static_cast<float>(time);
+    if (box_.num_nodes == 0) {
+      MoveGrid(positions, shift, pool);
+    }
+    UpdateSlices(time, pool);
+    if (!Interpolate(positions, shift, velocities, pool)) {
+      MoveGrid(positions, shift, pool);
+      UpdateSlices(time, pool);
+      Interpolate(positions, shift, velocities, pool);
+    }
+    return velocities;
+  }
+
+ private:
+  static const int64_t kNoSlice = INT64_MIN;
+  // Cells kept around the points when the grid moves, so a moving cloth
+  // does not move it often.
+  static const int kMargin = 1;
+
+  // Grid nodes first .. first + size - 1, in cells of the carried frame.
+  struct Box {
+    glm::ivec3 first = glm::ivec3(0);
+    glm::ivec3 size = glm::ivec3(0);
+    size_t num_nodes = 0;
+  };
+
+  // The field at every node, x fastest, as 4-float vectors so that a lookup
+  // interpolates all components at once, at time key * refresh_interval_.
+  struct Slice {
+    int64_t key = kNoSlice;
+    std::vector<float> values;
+  };
+
+  template <class F>
+  static void ParallelFor(ThreadPool* pool, size_t count, const F& fn) {
+    if (pool != nullptr) {
+      pool->ParallelFor(count, fn);
+    } else {
+      fn(0, count);
+    }
+  }
+
+  glm::vec3 EvaluateCarried(const glm::vec3& carried, double time) const {
+    glm::vec3 q = carried * inverse_length_scale_;
+    glm::vec3 drift = static_cast<float>(evolution_rate_ * time) *
+                      glm::vec3(0.31f, 0.57f, 0.76f);
+    // Vector potential from three decorrelated noises, and its curl.
+    glm::vec3 gradients[3];
+    const glm::vec3 offsets[3] = {glm::vec3(0.0f),
+                                  glm::vec3(31.4f, 47.2f, 11.9f),
+                                  glm::vec3(73.1f, 5.3f, 59.7f)};
+    for (int k = 0; k < 3; k++) {
+      FractalNoise(q + offsets[k], drift, gradients[k]);
+    }
+    glm::vec3 curl(gradients[2].y - gradients[1].z,
+                   gradients[0].z - gradients[2].x,
+                   gradients[1].x - gradients[0].y);
+    return mean_velocity_ + gust_scale_ * curl;
+  }
+
+  // Fits the grid around |positions| with a margin, keeping the nodes it
+  // shares with the old grid and baking only the new ones.
+  template <class TVec>
+  void MoveGrid(const std::vector<TVec>& positions,
+                const glm::vec3& shift,
+                ThreadPool* pool) {
+    glm::vec3 lo = glm::vec3(positions[0]) - shift;
+    glm::vec3 hi = lo;
+    for (const TVec& position : positions) {
+      glm::vec3 carried = glm::vec3(position) - shift;
+      lo = glm::min(lo, carried);
+      hi = glm::max(hi, carried);
+    }
+    Box old_box = box_;
+    box_.first = glm::ivec3(glm::floor(lo * inverse_cell_size_)) - kMargin;
+    glm::ivec3 last = glm::ivec3(glm::ceil(hi * inverse_cell_size_)) + kMargin;
+    box_.size = last - box_.first + 1;
+    box_.num_nodes =
+        static_cast<size_t>(box_.size.x) * box_.size.y * box_.size.z;
+    // Keeps the upper corners of a cell inside the grid.
+    grid_limit_ = glm::vec3(box_.size - 1) - 1e-3f;
+    for (Slice& slice : slices_) {
+      if (slice.key != kNoSlice) {
+        BakeSlice(slice, slice.key, &old_box, pool);
+      }
+    }
+    blended_.resize(4 * box_.num_nodes);
+    blended_key_ = kNoSlice;
+  }
+
+  // Bakes the slices around |time| if needed, and blends them for it.
+  void UpdateSlices(double time, ThreadPool* pool) {
+    int64_t key = static_cast<int64_t>(std::floor(time / refresh_interval_));
+    if (slices_[0].key != key) {
+      if (slices_[1].key == key) {
+        std::swap(slices_[0], slices_[1]);
+      } else {
+        BakeSlice(slices_[0], key, nullptr, pool);
+      }
+    }
+    if (slices_[1].key != key + 1) {
+      BakeSlice(slices_[1], key + 1, nullptr, pool);
+    }
+    float alpha = static_cast<float>(time / refresh_interval_ - key);
+    if (blended_key_ == key && blended_alpha_ == alpha) {
+      return;
+    }
+    const float* v0 = slices_[0].values.data();
+    const float* v1 = slices_[1].values.data();
+    float* blended = blended_.data();
+    ParallelFor(pool, blended_.size(), [&](size_t begin, size_t end) {
+      simd::Lerp(blended + begin, v0 + begin, v1 + begin, alpha, end - begin);
+    });
+    blended_key_ = key;
+    blended_alpha_ = alpha;
+  }
+
+  // Fills |slice| with the field at time |key| * refresh_interval_ on the
+  // current grid. With |old_box|, |slice| already holds that time on the
+  // old grid, and the nodes both grids share are copied from it.
+  void BakeSlice(Slice& slice,
+                 int64_t key,
+                 const Box* old_box,
+                 ThreadPool* pool) {
+    bake_values_.resize(4 * box_.num_nodes);
+    const float* old_values =
+        old_box != nullptr ? slice.values.data() : nullptr;
+    double time = key * refresh_interval_;
+    const size_t row = box_.size.x;
+    const size_t slab = row * box_.size.y;
+    ParallelFor(pool, box_.num_nodes, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        glm::ivec3 node(static_cast<int>(i % row),
+                        static_cast<int>(i / row % box_.size.y),
+                        static_cast<int>(i / slab));
+        glm::ivec3 cell = box_.first + node;
+        float* value = &bake_values_[4 * i];
+        if (old_values != nullptr && Contains(*old_box, cell)) {
+          const float* old_value =
+              &old_values[4 * Index(*old_box, cell - old_box->first)];
+          std::copy(old_value, old_value + 4, value);
+        } else {
+          glm::vec3 wind = EvaluateCarried(glm::vec3(cell) * cell_size_, time);
+          value[0] = wind.x;
+          value[1] = wind.y;
+          value[2] = wind.z;
+          value[3] = 0.0f;
+        }
+      }
+    });
+    slice.key = key;
+    slice.values.swap(bake_values_);
+  }
+
+  static bool Contains(const Box& box, const glm::ivec3& cell) {
+    return glm::all(glm::greaterThanEqual(cell, box.first)) &&
+           glm::all(glm::lessThan(cell, box.first + box.size));
+  }
+
+  static size_t Index(const Box& box, const glm::ivec3& node) {
+    return (static_cast<size_t>(node.z) * box.size.y + node.y) * box.size.x +
+           node.x;
+  }
+
+  // Trilinear lookups in the blended grid. Returns false if a position was
+  // outside the grid; its velocity is then taken from the nearest cell.
+  template <class TVec>
+  bool Interpolate(const std::vector<TVec>& positions,
+                   const glm::vec3& shift,
+                   std::vector<glm::vec3>& velocities,
+                   ThreadPool* pool) const {
+    std::atomic<bool> inside(true);
+    const glm::vec3 origin = glm::vec3(box_.first) * cell_size_ + shift;
+    ParallelFor(pool, positions.size(), [&](size_t begin, size_t end) {
+      const float* values = blended_.data();
+      const size_t row = 4 * static_cast<size_t>(box_.size.x);
+      const size_t slab = row * box_.size.y;
+      int outside = 0;
+      for (size_t i = begin; i < end; i++) {
+        glm::vec3 g = (glm::vec3(positions[i]) - origin) * inverse_cell_size_;
+        outside |= (g.x < 0.0f) | (g.y < 0.0f) | (g.z < 0.0f) |
+                   (g.x > grid_limit_.x) | (g.y > grid_limit_.y) |
+                   (g.z > grid_limit_.z);
+        g = glm::min(glm::max(g, glm::vec3(0.0f)), grid_limit_);
+        glm::ivec3 node(g);
+        glm::vec3 f = g - glm::vec3(node);
+        const float* corner =
+            values + node.z * slab + node.y * row + 4 * node.x;
+        simd::Trilinear4(&velocities[i].x, corner, row, slab, f.x, f.y, f.z);
+      }
+      if (outside != 0) {
+        inside.store(false, std::memory_order_relaxed);
+      }
+    });
+    return inside.load();
+  }
+
+  // Gradient of a sum of octaves of gradient noise, each of twice the
+  // frequency of the last and contributing half as much to the gradient, so
+  // finer gusts are weaker. Only the gradient is needed for the curl.
+  void FractalNoise(const glm::vec3& q,
+                    const glm::vec3& drift,
+                    glm::vec3& gradient) const {
+    gradient = glm::vec3(0.0f);
+    float frequency = 1.0f;
+    float weight = 1.0f;
+    for (int octave = 0; octave < num_octaves_; octave++) {
+      glm::vec3 octave_gradient;
+      Noise(q * frequency + drift * static_cast<float>(octave + 1),
+            octave_gradient);
+      gradient += weight * octave_gradient;
+      frequency *= 2.0f;
+      weight *= 0.5f;
+    }
+  }
+
+  // Improved Perlin noise with its analytic gradient. Returns the value.
+  float Noise(const glm::vec3& p, glm::vec3& gradient) const {
+    glm::vec3 floored = glm::floor(p);
+    glm::ivec3 cell = glm::ivec3(floored) & 255;
+    glm::vec3 f = p - floored;
+    glm::vec3 u = f * f * f * (f * (f * 6.0f - 15.0f) + 10.0f);
+    glm::vec3 du = 30.0f * f * f * (f * (f - 2.0f) + 1.0f);
+
+    glm::vec3 g[8];
+    float n[8];
+    for (int corner = 0; corner < 8; corner++) {
+      glm::ivec3 offset(corner & 1, (corner >> 1) & 1, corner >> 2);
+      glm::ivec3 c = cell + offset;
+      int hash = permutation_[permutation_[permutation_[c.x] + c.y] + c.z];
+      g[corner] = GetGradient(hash);
+      n[corner] = glm::dot(g[corner], f - glm::vec3(offset));
+    }
+    // Corners are indexed x + 2y + 4z.
+    float k1 = n[1] - n[0];
+    float k2 = n[2] - n[0];
+    float k3 = n[4] - n[0];
+    float k4 = n[0] - n[1] - n[2] + n[3];
+    float k5 = n[0] - n[2] - n[4] + n[6];
+    float k6 = n[0] - n[1] - n[4] + n[5];
+    float k7 = -n[0] + n[1] + n[2] - n[3] + n[4] - n[5] - n[6] + n[7];
+    glm::vec3 gradient_mix =
+        glm::mix(glm::mix(glm::mix(g[0], g[1], u.x), glm::mix(g[2], g[3], u.x),
+                          u.y),
+                 glm::mix(glm::mix(g[4], g[5], u.x), glm::mix(g[6], g[7], u.x),
+                          u.y),
+                 u.z);
+    gradient = gradient_mix +
+               du * glm::vec3(k1 + k4 * u.y + k6 * u.z + k7 * u.y * u.z,
+                              k2 + k5 * u.z + k4 * u.x + k7 * u.z * u.x,
+                              k3 + k6 * u.x + k5 * u.y + k7 * u.x * u.y);
+    return n[0] + k1 * u.x + k2 * u.y + k3 * u.z + k4 * u.x * u.y +
+           k5 * u.y * u.z + k6 * u.z * u.x + k7 * u.x * u.y * u.z;
+  }
+
+  // The 12 edge directions of a cube, as in improved Perlin noise.
+  static glm::vec3 GetGradient(int hash) {
+    static const glm::vec3 kGradients[16] = {
+        glm::vec3(1, 1, 0),  glm::vec3(-1, 1, 0), glm::vec3(1, -1, 0),
+        glm::vec3(-1, -1, 0), glm::vec3(1, 0, 1),  glm::vec3(-1, 0, 1),
+        glm::vec3(1, 0, -1), glm::vec3(-1, 0, -1), glm::vec3(0, 1, 1),
+        glm::vec3(0, -1, 1), glm::vec3(0, 1, -1), glm::vec3(0, -1, -1),
+        glm::vec3(1, 1, 0),  glm::vec3(0, -1, 1), glm::vec3(-1, 1, 0),
+        glm::vec3(0, -1, -1)};
+    return kGradients[hash & 15];
+  }
+
+  glm::vec3 mean_velocity_;
+  float gust_scale_;
+  float inverse_length_scale_;
+  int num_octaves_;
+  float evolution_rate_;
+  uint8_t permutation_[512];
+
+  float cell_size_;
+  float inverse_cell_size_ = 0.0f;
+  double refresh_interval_;
+  Box box_;
+  glm::vec3 grid_limit_ = glm::vec3(0.0f);
+  Slice slices_[2];
+  std::vector<float> bake_values_;
+  // slices_ blended for the last sample time, which is identified by its
+  // slice key and blend weight.
+  std::vector<float> blended_;
+  int64_t blended_key_ = kNoSlice;
+  float blended_alpha_ = 0.0f;
+  // The last samples, at |sample_time_|.
+  std::vector<glm::vec3> samples_;
+  bool has_samples_ = false;
+  double sample_time_ = 0.0;
+};
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef WIND_FORCE_H_
+#define WIND_FORCE_H_
+
+#include <memory>
+#include <vector>
+
+#include "DragForce.hpp"
+#include "ForceModule.hpp"
+#include "SimdKernels.hpp"
+#include "WindField.hpp"
+
+namespace GLOO {
+// The push of a WindField on the particles and triangles of the system.
+// With it, drag pulls particles toward the air velocity instead of rest, and
+// each triangle is pushed along its normal in proportion to its area and to
+// the normal speed of the air relative to it. The wind is sampled once per
+// particle and evaluation time (see WindField::Sample); triangles use the
+// mean of their corners.
+//
+// The drag * wind part of drag * (wind - v) is added here, with the current
+// coefficient of the system's DragForce, which adds the -drag * v part.
+// Keeping it here lets it share the wind samples with the triangles.
+template <class T>
+class WindForceT : public ForceModuleT<T> {
+ public:
+  typedef typename ForceModuleT<T>::State State;
+  typedef typename ForceModuleT<T>::Vec3 Vec3;
+
+  // |drag| is the DragForce registered with the same system, and
+  // |pressure_coefficient| scales the force on triangles.
+  WindForceT(std::shared_ptr<WindField> wind,
+             std::shared_ptr<const DragForceT<T>> drag,
+             float pressure_coefficient)
+      : wind_(std::move(wind)),
+        drag_(std::move(drag)),
+        pressure_coefficient_(pressure_coefficient),
+        incidence_version_(kNoVersion) {
+  }
+
+  const std::shared_ptr<WindField>& GetWind() const {
+    return wind_;
+  }
+
+  const char* GetName() const override {
+    return "wind";
+  }
+
+  // Not thread safe: the wind field may bake its grid here.
+  void AccumulateForces(const ForceContext& context,
+                        const State& state,
+                        double time,
+                        std::vector<Vec3>& forces) const override {
+    const std::vector<glm::vec3>& wind =
+        wind_->Sample(state.positions, time, context.pool);
+    relative_velocities_.resize(wind.size());
+    T drag = drag_->GetDragCoefficient();
+    context.ParallelFor(forces.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        forces[i] += drag * Vec3(wind[i]);
+        relative_velocities_[i] = wind[i] - glm::vec3(state.velocities[i]);
+      }
+    });
+    if (context.triangles.empty() || pressure_coefficient_ == 0.0f) {
+      return;
+    }
+    if (context.pool != nullptr) {
+      AccumulateTriangleForcesParallel(context, state, forces);
+      return;
+    }
+    const std::vector<Triangle>& triangles = context.triangles;
+    ForEachCornerForce(triangles, 0, triangles.size(), state,
+                       [&](size_t t, const glm::vec3& corner_force) {
+                         const int* p = triangles[t].particle_indices;
+                         forces[p[0]] += Vec3(corner_force);
+                         forces[p[1]] += Vec3(corner_force);
+                         forces[p[2]] += Vec3(corner_force);
+                       });
+  }
+
+ private:
+  // Calls emit(t, force) with a third of the pressure of the wind on each
+  // triangle t in [begin, end), which goes to each of its corners: pressure
+  // coefficient * area * relative normal speed, along the normal. Either
+  // side of the cloth can catch the wind. Blocks of triangles are gathered
+  // into arrays and their forces computed with simd::ProjectOnCross.
+  template <class F>
+  void ForEachCornerForce(const std::vector<Triangle>& triangles,
+                          size_t begin,
+                          size_t end,
+                          const State& state,
+                          const F& emit) const {
+    // Edges from the first corner, the sum of the relative velocities and
+    // the forces, each as x, y and z rows.
+    float edges1[3 * kBlockSize];
+    float edges2[3 * kBlockSize];
+    float relative[3 * kBlockSize];
+    float corner_forces[3 * kBlockSize];
+    // The cross product of the edges is twice the area along the normal,
+    // and the sum three times the mean relative velocity.
+    const float scale = pressure_coefficient_ / 18.0f;
+    for (size_t first = begin; first < end; first += kBlockSize) {
+      size_t count = end - first < kBlockSize ? end - first : kBlockSize;
+      for (size_t j = 0; j < count; j++) {
+        const int* p = triangles[first + j].particle_indices;
+        glm::vec3 a(state.positions[p[0]]);
+        glm::vec3 e1 = glm::vec3(state.positions[p[1]]) - a;
+        glm::vec3 e2 = glm::vec3(state.positions[p[2]]) - a;
+        glm::vec3 r = relative_velocities_[p[0]] + relative_velocities_[p[1]] +
+                      relative_velocities_[p[2]];
+        for (int k = 0; k < 3; k++) {
+          edges1[k * kBlockSize + j] = e1[k];
+          edges2[k * kBlockSize + j] = e2[k];
+          relative[k * kBlockSize + j] = r[k];
+        }
+      }
+      simd::ProjectOnCross(corner_forces, edges1, edges2, relative, scale,
+                           kBlockSize, count);
+      for (size_t j = 0; j < count; j++) {
+        emit(first + j, glm::vec3(corner_forces[j],
+                                  corner_forces[kBlockSize + j],
+                                  corner_forces[2 * kBlockSize + j]));
+      }
+    }
+  }
+
+  // Triangles sharing a particle would race on its force, so the triangle
+  // forces are computed first and each particle then gathers those of its
+  // triangles, in a fixed order.
+  void AccumulateTriangleForcesParallel(const ForceContext& context,
+                                        const State& state,
+                                        std::vector<Vec3>& forces) const {
+    const std::vector<Triangle>& triangles = context.triangles;
+    UpdateIncidence(context);
+    triangle_forces_.resize(triangles.size());
+    context.ParallelFor(triangles.size(), [&](size_t begin, size_t end) {
+      ForEachCornerForce(triangles, begin, end, state,
+                         [&](size_t t, const glm::vec3& corner_force) {
+                           triangle_forces_[t] = corner_force;
+                         });
+    });
+    context.ParallelFor(forces.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        glm::vec3 sum(0.0f);
+        for (int k = incidence_start_[i]; k < incidence_start_[i + 1]; k++) {
+          sum += triangle_forces_[incidence_[k]];
+        }
+        forces[i] += Vec3(sum);
+      }
+    });
+  }
+
+  // Triangles of each particle, as a compressed list; rebuilt when the
+  // system's topology changes.
+  void UpdateIncidence(const ForceContext& context) const {
+    if (incidence_version_ == context.topology_version) {
+      return;
+    }
+    incidence_version_ = context.topology_version;
+    const std::vector<Triangle>& triangles = context.triangles;
+    size_t num_particles = context.particles.size();
+    incidence_start_.assign(num_particles + 1, 0);
+    for (const Triangle& triangle : triangles) {
+      for (int k = 0; k < 3; k++) {
+        incidence_start_[triangle.particle_indices[k] + 1]++;
+      }
+    }
+    for (size_t i = 0; i < num_particles; i++) {
+      incidence_start_[i + 1] += incidence_start_[i];
+    }
+    incidence_.resize(incidence_start_.back());
+    std::vector<int> fill(incidence_start_.begin(), incidence_start_.end() - 1);
+    for (size_t t = 0; t < triangles.size(); t++) {
+      for (int k = 0; k < 3; k++) {
+        incidence_[fill[triangles[t].particle_indices[k]]++] =
+            static_cast<int>(t);
+      }
+    }
+  }
+
+  static const size_t kNoVersion = static_cast<size_t>(-1);
+  static const size_t kBlockSize = 64;
+
+  std::shared_ptr<WindField> wind_;
+  std::shared_ptr<const DragForceT<T>> drag_;
+  float pressure_coefficient_;
+
+  mutable std::vector<glm::vec3> relative_velocities_;
+  mutable std::vector<glm::vec3> triangle_forces_;
+  mutable std::vector<int> incidence_start_;
+  mutable std::vector<int> incidence_;
+  mutable size_t incidence_version_;
+};
+
+typedef WindForceT<float> WindForce;
+}  // namespace GLOO
+
+#endif
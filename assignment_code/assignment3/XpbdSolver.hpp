@@ -0,0 +1,128 @@
+#ifndef XPBD_SOLVER_H_
+#define XPBD_SOLVER_H_
+
+#include <memory>
+#include <vector>
+
+#include "ClothSolverBase.hpp"
+#include "PendulumSystem.hpp"
+
+namespace GLOO {
+// Extended position-based dynamics (Macklin et al. 2016) on the topology of a
+// PendulumSystem. Every spring becomes a distance constraint with compliance
+// 1 / stiffness (scaled by compliance_scale), so the default behaves like the
+// mass-spring cloth in the limit of many iterations, and compliance_scale = 0
+// gives inextensible cloth. The other force modules of the system act as
+// external forces.
+//
+// Constraints are relaxed Gauss-Seidel style in the conflict-free spring
+// batches of the system. Springs in a batch share no particles, so when the
+// system has a thread pool each batch is solved in parallel, with results
+// independent of the thread count. Stable at one step per frame; the
+// iteration count trades stiffness for time.
+class XpbdSolver : public ClothSolverBase {
+ public:
+  XpbdSolver(std::shared_ptr<PendulumSystem> system,
+             int iterations,
+             float compliance_scale = 1.0f)
+      : system_(std::move(system)),
+        iterations_(iterations),
+        compliance_scale_(compliance_scale) {
+  }
+
+  void SetIterations(int iterations) {
+    iterations_ = iterations;
+  }
+
+  void SetComplianceScale(float compliance_scale) {
+    compliance_scale_ = compliance_scale;
+  }
+
+  void Step(ParticleState& state, double time, float dt) override {
+    const std::vector<Particle>& particles = system_->GetParticles();
+    const std::vector<Spring>& springs = system_->GetSprings();
+    size_t num_particles = state.positions.size();
+
+    // Predict positions from external forces, and move kinematic particles
+    // to where they are at the end of the step.
+    const std::vector<int>& dynamic = system_->GetDynamicIndices();
+    system_->ComputeExternalForces(state, time, external_forces_);
+    previous_positions_ = state.positions;
+    inverse_masses_.assign(num_particles, 0.0f);
+    for (int i : dynamic) {
+      inverse_masses_[i] = 1.0f / particles[i].mass;
+      state.velocities[i] += dt * inverse_masses_[i] * external_forces_[i];
+      state.positions[i] += dt * state.velocities[i];
+    }
+    for (int i : system_->GetKinematicIndices()) {
+      state.velocities[i] = glm::vec3(0.0f);
+    }
+    system_->UpdateKinematicParticles(state, time + dt);
+
+    lambdas_.assign(springs.size(), 0.0f);
+    const SpringBatches& batches = system_->GetSpringBatches();
+    ThreadPool* pool = system_->GetThreadPool().get();
+    float inverse_dt2 = 1.0f / (dt * dt);
+    for (int iteration = 0; iteration < iterations_; iteration++) {
+      for (size_t b = 0; b < batches.GetNumBatches(); b++) {
+        const int* batch = batches.order.data() + batches.offsets[b];
+        size_t batch_size = batches.offsets[b + 1] - batches.offsets[b];
+        auto solve = [&](size_t begin, size_t end) {
+          for (size_t k = begin; k < end; k++) {
+            SolveDistanceConstraint(batch[k], springs[batch[k]], inverse_dt2,
+                                    state.positions);
+          }
+        };
+        if (pool != nullptr) {
+          pool->ParallelFor(batch_size, solve);
+        } else {
+          solve(0, batch_size);
+        }
+      }
+    }
+
+    float inverse_dt = 1.0f / dt;
+    for (int i : dynamic) {
+      state.velocities[i] =
+          (state.positions[i] - previous_positions_[i]) * inverse_dt;
+    }
+  }
+
+ private:
+  void SolveDistanceConstraint(int index,
+                               const Spring& spring,
+                               float inverse_dt2,
+                               std::vector<glm::vec3>& positions) {
+    int i = spring.particle1_index;
+    int j = spring.particle2_index;
+    float w = inverse_masses_[i] + inverse_masses_[j];
+    if (w == 0.0f) {
+      return;
+    }
+    glm::vec3 d = positions[i] - positions[j];
+    float length = glm::length(d);
+    if (length <= 1e-6f) {
+      return;
+    }
+    glm::vec3 direction = d / length;
+    float constraint = length - spring.rest_length;
+    float alpha = compliance_scale_ / spring.stiffness * inverse_dt2;
+    float delta_lambda =
+        (-constraint - alpha * lambdas_[index]) / (w + alpha);
+    lambdas_[index] += delta_lambda;
+    positions[i] += inverse_masses_[i] * delta_lambda * direction;
+    positions[j] -= inverse_masses_[j] * delta_lambda * direction;
+  }
+
+  std::shared_ptr<PendulumSystem> system_;
+  int iterations_;
+  float compliance_scale_;
+
+  std::vector<glm::vec3> previous_positions_;
+  std::vector<float> inverse_masses_;
+  std::vector<glm::vec3> external_forces_;
+  std::vector<float> lambdas_;
+};
+}  // namespace GLOO
+
+#endif
@@ -6,42 +6,57 @@
 
 #include "SimulationApp.hpp"
 #include "IntegratorType.hpp"
+#include "ClothSolverType.hpp"
 
 using namespace GLOO;
 
 int main(int argc, char** argv) {
-  if (argc != 3) {
-    printf("Usage: %s <e|t|r> <timestep>\n", argv[0]);
+  if (argc < 3 || argc > 5) {
+    printf("Usage: %s <e|t|r|i|d|s|v> <timestep> [m|x|p] "
+           "[trajectory|prop.obj]\n",
+           argv[0]);
     printf("       e: Integrator: Forward Euler\n");
     printf("       t: Integrator: Trapezoid\n");
     printf("       r: Integrator: RK 4\n");
+    printf("       i: Integrator: Implicit Euler\n");
+    printf("       d: Integrator: Dormand-Prince 5(4), adaptive;\n");
+    printf("          timestep is the output interval and largest substep\n");
+    printf("       s: Integrator: Symplectic Euler\n");
+    printf("       v: Integrator: Velocity Verlet\n");
+    printf("       m: Cloth: mass-spring with the integrator above (default)\n");
+    printf("       x: Cloth: XPBD distance constraints\n");
+    printf("       p: Cloth: projective dynamics, prefactored global solve\n");
+    printf("       trajectory: replay a cloth or pendulum recorded with "
+           "sim_runner --record\n");
+    printf("       prop.obj: swing this mesh from the assets directory through "
+           "the cloth\n");
+    printf("                 in place of the sphere\n");
     printf("\n");
     printf("Try  : %s t 0.001\n", argv[0]);
     printf("       for trapezoid (1ms steps)\n");
     printf("Or   : %s r 0.005\n", argv[0]);
     printf("       for RK4 (5ms steps)\n");
+    printf("Or   : %s i 0.0166\n", argv[0]);
+    printf("       for implicit Euler (one step per frame)\n");
+    printf("Or   : %s r 0.0166 x\n", argv[0]);
+    printf("       for XPBD cloth (one step per frame)\n");
     return -1;
   }
 
-  IntegratorType integrator_type;
-  switch (argv[1][0]) {
-    case 'e':
-      integrator_type = IntegratorType::Euler;
-      break;
-    case 't':
-      integrator_type = IntegratorType::Trapezoidal;
-      break;
-    case 'r':
-      integrator_type = IntegratorType::RK4;
-      break;
-    default:
-      throw std::runtime_error(
-          "Unrecognized integrator type: " + std::string(1, argv[1][0]) + ".");
-  }
+  IntegratorType integrator_type = ParseIntegratorType(argv[1][0]);
   float integration_step = std::stof(argv[2]);
+  ClothSolverType cloth_solver_type = argc >= 4
+                                          ? ParseClothSolverType(argv[3][0])
+                                          : ClothSolverType::MassSpring;
+  // The last argument is a prop if it names an OBJ file, else a trajectory.
+  std::string path = argc == 5 ? argv[4] : "";
+  bool is_prop = path.size() > 4 && path.substr(path.size() - 4) == ".obj";
+  std::string replay_path = is_prop ? "" : path;
+  std::string prop_path = is_prop ? path : "";
 
   std::unique_ptr<SimulationApp> app = make_unique<SimulationApp>(
-      "Assignment3", glm::ivec2(1440, 900), integrator_type, integration_step);
+      "Assignment3", glm::ivec2(1440, 900), integrator_type, integration_step,
+      cloth_solver_type, replay_path, prop_path);
 
   app->SetupScene();
 
@@ -0,0 +1,81 @@
+#ifndef ALLOCATION_COUNTER_H_
+#define ALLOCATION_COUNTER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Heap accounting for the tools. Replaces the global operator new and
+// delete, so include it from exactly one source file of an executable.
+// Every allocation carries a header with its size, so tools can report both
+// the number of allocations and the live heap footprint. The header keeps
+// the 16-byte alignment that malloc guarantees.
+namespace {
+const size_t kHeaderSize = 16;
+std::atomic<uint64_t> num_allocations(0);
+std::atomic<int64_t> live_bytes(0);
+
+void* CountedAllocate(size_t size) {
+  void* block = std::malloc(size + kHeaderSize);
+  if (block == nullptr) {
+    return nullptr;
+  }
+  *static_cast<size_t*>(block) = size;
+  num_allocations++;
+  live_bytes += size;
+  return static_cast<char*>(block) + kHeaderSize;
+}
+
+void CountedFree(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  void* block = static_cast<char*>(ptr) - kHeaderSize;
+  live_bytes -= *static_cast<size_t*>(block);
+  std::free(block);
+}
+}  // namespace
+
+void* operator new(size_t size) {
+  void* ptr = CountedAllocate(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return CountedAllocate(size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return CountedAllocate(size);
+}
+void operator delete(void* ptr) noexcept {
+  CountedFree(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+  CountedFree(ptr);
+}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  CountedFree(ptr);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  CountedFree(ptr);
+}
+
+namespace GLOO {
+// Allocations made so far, on any thread.
+inline uint64_t GetNumAllocations() {
+  return num_allocations;
+}
+
+// Bytes currently allocated with operator new.
+inline int64_t GetLiveHeapBytes() {
+  return live_bytes;
+}
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,89 @@
+// Checks that integrator steps do not allocate once their workspace is
+// sized: steps every integrator on a small cloth in each precision, serial
+// and on a pool, and fails if a step after the first few allocates.
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+
+#include "AllocationCounter.hpp"
+#include "IntegratorFactory.hpp"
+#include "IntegratorType.hpp"
+#include "PrecisionMode.hpp"
+#include "SimulationScenes.hpp"
+#include "ThreadPool.hpp"
+
+using namespace GLOO;
+
+namespace {
+const int kGridSize = 16;
+const float kStep = 1e-3f;
+// Steps that may allocate while the workspace and caches are sized.
+const int kWarmupSteps = 4;
+const int kCheckedSteps = 32;
+
+// Allocations of the checked steps of |type|.
+template <PrecisionMode mode>
+uint64_t CountStepAllocations(IntegratorType type,
+                              const std::shared_ptr<ThreadPool>& pool) {
+  typedef typename PrecisionTraits<mode>::PendulumSystemType SystemType;
+  typedef typename SystemType::State State;
+  SimulationScene<SystemType> scene = BuildClothScene<SystemType>(kGridSize);
+  scene.system->SetThreadPool(pool);
+  State state = scene.initial_state;
+  IntegratorWorkspace<State> workspace;
+  workspace.adaptive_step = kStep;
+  auto integrator =
+      IntegratorFactory::CreateIntegrator<SystemType, State>(type);
+  double time = 0.0;
+  integrator->IntegrateSteps(*scene.system, state, time, kStep, kWarmupSteps,
+                             workspace);
+  time += kWarmupSteps * static_cast<double>(kStep);
+  uint64_t allocations_before = GetNumAllocations();
+  for (int s = 0; s < kCheckedSteps; s++) {
+    integrator->IntegrateSteps(*scene.system, state, time, kStep, 1,
+                               workspace);
+    time += kStep;
+  }
+  return GetNumAllocations() - allocations_before;
+}
+
+// Prints a line per integrator and returns the number that allocated.
+template <PrecisionMode mode>
+int CheckPrecision(const std::shared_ptr<ThreadPool>& pool) {
+  int failures = 0;
+  for (IntegratorType type : kIntegratorTypes) {
+    uint64_t allocations = CountStepAllocations<mode>(type, pool);
+    bool passed = allocations == 0;
+    int num_threads = pool != nullptr ? pool->GetNumThreads() : 0;
+    printf("%-4s %-18s %-6s threads %d  %llu allocations\n",
+           passed ? "ok" : "FAIL", GetIntegratorName(type),
+           GetPrecisionModeName(mode), num_threads,
+           static_cast<unsigned long long>(allocations));
+    failures += passed ? 0 : 1;
+  }
+  return failures;
+}
+}  // namespace
+
+int main() {
+  try {
+    int failures = 0;
+    std::shared_ptr<ThreadPool> pools[] = {nullptr,
+                                           std::make_shared<ThreadPool>(2)};
+    for (const std::shared_ptr<ThreadPool>& pool : pools) {
+      failures += CheckPrecision<PrecisionMode::Float>(pool);
+      failures += CheckPrecision<PrecisionMode::Double>(pool);
+      failures += CheckPrecision<PrecisionMode::Mixed>(pool);
+    }
+    if (failures > 0) {
+      fprintf(stderr, "%d integrators allocated in steady state\n", failures);
+      return 1;
+    }
+    return 0;
+  } catch (const std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+}
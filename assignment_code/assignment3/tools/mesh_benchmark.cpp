@@ -0,0 +1,321 @@
+// Benchmarks of the mesh collider on procedural props: the time to build the
+// BVH, and the throughput of contact queries for batches of points near the
+// surface, as cloth particles draping over it would be, and of unbounded
+// closest-point queries from around it; then the same for a distance grid
+// baked from it. Points are queried in random order, which is the worst case
+// for the caches. Results are written as JSON.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "MeshCollider.hpp"
+#include "SdfCollider.hpp"
+#include "SimulationScenes.hpp"
+#include "ThreadPool.hpp"
+
+using namespace GLOO;
+
+namespace {
+struct BenchmarkOptions {
+  // About 25k, 100k, 400k and 1.6M triangles.
+  std::vector<int> rings = {80, 160, 320, 640};
+  std::vector<int> thread_counts = {0};
+  int num_queries = 1 << 16;
+  int grid_resolution = 128;
+  double min_time = 0.2;
+  std::string output;
+};
+
+struct BenchmarkResult {
+  std::string name;
+  size_t num_triangles;
+  // BVH nodes, or grid nodes for the distance grid cases.
+  size_t num_nodes;
+  int num_threads;
+  int64_t num_iterations;
+  double seconds;
+  // Queries answered per iteration; 0 for the build.
+  int queries_per_iteration;
+  // Fraction of the queries that found a contact or a closest point.
+  double hit_rate;
+};
+
+// Distance kept from the surface and deepest penetration resolved, relative
+// to the unit size of the procedural mesh.
+const float kMargin = 0.02f;
+const float kMaxDepth = 0.25f;
+
+std::vector<int> ParseIntList(const std::string& list) {
+  std::vector<int> values;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    values.push_back(std::stoi(item));
+  }
+  return values;
+}
+
+void PrintUsage(const char* program) {
+  printf("Usage: %s [options]\n", program);
+  printf("       --rings 80,160,...    sphere resolutions, about 4 * rings^2 "
+         "triangles\n");
+  printf("                             (default 80 to 640)\n");
+  printf("       --threads 0,2,...     thread counts, 0 is serial "
+         "(default 0)\n");
+  printf("       --queries N           points per batch (default 65536)\n");
+  printf("       --grid N              distance grid nodes along the longest "
+         "side\n");
+  printf("                             (default 128)\n");
+  printf("       --min-time S          minimum time per case (default 0.2)\n");
+  printf("       --output FILE         write JSON to FILE instead of "
+         "stdout\n");
+}
+
+BenchmarkOptions ParseOptions(int argc, char** argv) {
+  BenchmarkOptions options;
+  for (int a = 1; a < argc; a++) {
+    std::string flag = argv[a];
+    if (a + 1 == argc) {
+      throw std::runtime_error("Missing value for " + flag + ".");
+    }
+    std::string value = argv[++a];
+    if (flag == "--rings") {
+      options.rings = ParseIntList(value);
+    } else if (flag == "--threads") {
+      options.thread_counts = ParseIntList(value);
+    } else if (flag == "--queries") {
+      options.num_queries = std::stoi(value);
+    } else if (flag == "--grid") {
+      options.grid_resolution = std::stoi(value);
+    } else if (flag == "--min-time") {
+      options.min_time = std::stod(value);
+    } else if (flag == "--output") {
+      options.output = value;
+    } else {
+      throw std::runtime_error("Unrecognized option: " + flag + ".");
+    }
+  }
+  return options;
+}
+
+// Runs |run| on doubling batches until a batch takes at least min_time, and
+// returns the seconds and iterations of the last batch.
+template <class F>
+double TimeBatches(double min_time, const F& run, int64_t& iterations) {
+  iterations = 1;
+  while (true) {
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < iterations; i++) {
+      run();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (elapsed.count() >= min_time || iterations >= (1 << 24)) {
+      return elapsed.count();
+    }
+    iterations *= 2;
+  }
+}
+
+template <class F>
+void RunParallel(ThreadPool* pool, size_t count, const F& fn) {
+  if (pool != nullptr) {
+    pool->ParallelFor(count, fn);
+  } else {
+    fn(0, count);
+  }
+}
+
+void WriteJson(FILE* file, const std::vector<BenchmarkResult>& results) {
+  fprintf(file, "{\n  \"format_version\": 1,\n  \"results\": [");
+  for (size_t r = 0; r < results.size(); r++) {
+    const BenchmarkResult& result = results[r];
+    double per_iteration = result.seconds / result.num_iterations;
+    double queries = static_cast<double>(result.queries_per_iteration);
+    fprintf(file,
+            "%s\n    {\"name\": \"%s\", \"triangles\": %zu, \"nodes\": %zu, "
+            "\"threads\": %d, \"iterations\": %lld, \"seconds\": %.6f, "
+            "\"ms_per_iteration\": %.3f, \"ns_per_query\": %.3f, "
+            "\"queries_per_second\": %.0f, \"hit_rate\": %.3f}",
+            r == 0 ? "" : ",", result.name.c_str(), result.num_triangles,
+            result.num_nodes, result.num_threads,
+            static_cast<long long>(result.num_iterations), result.seconds,
+            per_iteration * 1e3,
+            queries > 0.0 ? per_iteration * 1e9 / queries : 0.0,
+            queries > 0.0 ? queries / per_iteration : 0.0, result.hit_rate);
+  }
+  fprintf(file, "\n  ]\n}\n");
+}
+
+void RunCases(const BenchmarkOptions& options,
+              int rings,
+              std::vector<BenchmarkResult>& results) {
+  std::vector<glm::vec3> positions;
+  std::vector<unsigned int> indices;
+  BuildBumpySphereMesh(rings, positions, indices);
+  const size_t num_triangles = indices.size() / 3;
+
+  BenchmarkResult result;
+  result.num_triangles = num_triangles;
+  result.num_threads = 0;
+  result.queries_per_iteration = 0;
+  result.hit_rate = 0.0;
+  fprintf(stderr, "%-16s triangles %8zu\n", "build", num_triangles);
+  std::unique_ptr<MeshCollider> collider;
+  result.seconds = TimeBatches(
+      options.min_time,
+      [&]() {
+        collider.reset(new MeshCollider(positions, indices, kMaxDepth));
+      },
+      result.num_iterations);
+  result.name = "build";
+  result.num_nodes = collider->GetBvh().GetNumNodes();
+  results.push_back(result);
+
+  // Points within the contact band, on both sides of the surface, and
+  // points outside it up to half the radius away. Points deep inside a
+  // sphere are close to all of it, which no hierarchy can prune.
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  std::vector<glm::vec3> near_points(options.num_queries);
+  std::vector<glm::vec3> far_points(options.num_queries);
+  for (int q = 0; q < options.num_queries; q++) {
+    const glm::vec3& vertex = positions[rng() % positions.size()];
+    near_points[q] = vertex * (1.0f + 0.05f * unit(rng));
+    far_points[q] = vertex * (1.25f + 0.25f * unit(rng));
+  }
+
+  for (int num_threads : options.thread_counts) {
+    std::unique_ptr<ThreadPool> pool;
+    if (num_threads > 0) {
+      pool.reset(new ThreadPool(num_threads));
+    }
+    result.num_threads = num_threads;
+    result.num_nodes = collider->GetBvh().GetNumNodes();
+    result.queries_per_iteration = options.num_queries;
+    std::atomic<int> hits(0);
+
+    fprintf(stderr, "%-16s triangles %8zu threads %d\n", "query/contact",
+            num_triangles, num_threads);
+    result.seconds = TimeBatches(
+        options.min_time,
+        [&]() {
+          hits = 0;
+          RunParallel(pool.get(), near_points.size(),
+                      [&](size_t begin, size_t end) {
+                        int found = 0;
+                        Contact contact;
+                        for (size_t q = begin; q < end; q++) {
+                          found += collider->FindContact(near_points[q],
+                                                         kMargin, contact);
+                        }
+                        hits += found;
+                      });
+        },
+        result.num_iterations);
+    result.name = "query/contact";
+    result.hit_rate = static_cast<double>(hits) / options.num_queries;
+    results.push_back(result);
+
+    fprintf(stderr, "%-16s triangles %8zu threads %d\n", "query/closest",
+            num_triangles, num_threads);
+    result.seconds = TimeBatches(
+        options.min_time,
+        [&]() {
+          hits = 0;
+          RunParallel(pool.get(), far_points.size(),
+                      [&](size_t begin, size_t end) {
+                        int found = 0;
+                        ClosestTriangleHit hit;
+                        for (size_t q = begin; q < end; q++) {
+                          found += collider->GetBvh().FindClosest(
+                              far_points[q], 1e30f, hit);
+                        }
+                        hits += found;
+                      });
+        },
+        result.num_iterations);
+    result.name = "query/closest";
+    result.hit_rate = static_cast<double>(hits) / options.num_queries;
+    results.push_back(result);
+
+    // The grid's band matches the depth the mesh collider resolves.
+    fprintf(stderr, "%-16s triangles %8zu threads %d\n", "sdf/bake",
+            num_triangles, num_threads);
+    std::unique_ptr<SdfCollider> sdf;
+    result.seconds = TimeBatches(
+        options.min_time,
+        [&]() {
+          sdf.reset(new SdfCollider(DistanceGrid::Bake(
+              *collider, options.grid_resolution, kMaxDepth, pool.get())));
+        },
+        result.num_iterations);
+    result.name = "sdf/bake";
+    result.num_nodes = sdf->GetGrid().GetNumValues();
+    result.queries_per_iteration = 0;
+    result.hit_rate = 0.0;
+    results.push_back(result);
+
+    fprintf(stderr, "%-16s triangles %8zu threads %d\n", "sdf/contact",
+            num_triangles, num_threads);
+    result.seconds = TimeBatches(
+        options.min_time,
+        [&]() {
+          hits = 0;
+          RunParallel(pool.get(), near_points.size(),
+                      [&](size_t begin, size_t end) {
+                        int found = 0;
+                        Contact contact;
+                        for (size_t q = begin; q < end; q++) {
+                          found +=
+                              sdf->FindContact(near_points[q], kMargin, contact);
+                        }
+                        hits += found;
+                      });
+        },
+        result.num_iterations);
+    result.name = "sdf/contact";
+    result.queries_per_iteration = options.num_queries;
+    result.hit_rate = static_cast<double>(hits) / options.num_queries;
+    results.push_back(result);
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1 && std::string(argv[1]) == "--help") {
+    PrintUsage(argv[0]);
+    return 0;
+  }
+  try {
+    BenchmarkOptions options = ParseOptions(argc, argv);
+    std::vector<BenchmarkResult> results;
+    for (int rings : options.rings) {
+      RunCases(options, rings, results);
+    }
+
+    FILE* file = stdout;
+    if (!options.output.empty()) {
+      file = fopen(options.output.c_str(), "w");
+      if (file == nullptr) {
+        throw std::runtime_error("Cannot open " + options.output + ".");
+      }
+    }
+    WriteJson(file, results);
+    if (file != stdout) {
+      fclose(file);
+    }
+  } catch (const std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
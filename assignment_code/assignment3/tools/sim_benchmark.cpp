@@ -0,0 +1,703 @@
+// Micro-benchmarks of the cloth simulation: force evaluation, every
+// integrator, and whole frames as ClothNode runs them, over a range of grid
+// sizes, plus pendulum ensembles of as many particles. Results are written as
+// JSON so runs can be compared across versions. Cases run with several
+// --threads values also report their speedup over the serial run (--threads
+// 0) of the same case.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "AllocationCounter.hpp"
+#include "ClothSolverFactory.hpp"
+#include "ColliderForce.hpp"
+#include "CollisionStage.hpp"
+#include "FixedStepScheduler.hpp"
+#include "IntegratorFactory.hpp"
+#include "PendulumEnsemble.hpp"
+#include "PrecisionMode.hpp"
+#include "SimulationScenes.hpp"
+#include "ThreadPool.hpp"
+#include "UserForce.hpp"
+
+using namespace GLOO;
+
+namespace {
+struct BenchmarkOptions {
+  std::vector<int> grid_sizes = {8, 16, 32, 64, 128, 256, 512};
+  std::vector<PrecisionMode> precisions = {PrecisionMode::Float};
+  std::vector<int> thread_counts = {0};
+  float integration_step = 1e-3f;
+  double min_time = 0.2;
+  std::string filter;
+  std::string output;
+};
+
+struct BenchmarkResult {
+  std::string name;
+  PrecisionMode precision;
+  int grid_size;
+  int num_threads;
+  size_t num_particles;
+  int64_t num_steps;
+  double seconds;
+  double allocations_per_step;
+  int64_t footprint_bytes;
+};
+
+// The prefactored projective dynamics solve has a banded factor of about
+// N * 2 * grid entries, which stops fitting in memory beyond this size.
+const int kMaxProjectiveGridSize = 128;
+// Frame length of the ClothNode cases.
+const float kFrameTime = 1.0f / 60.0f;
+
+std::vector<std::string> SplitList(const std::string& list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    items.push_back(item);
+  }
+  return items;
+}
+
+std::vector<int> ParseIntList(const std::string& list) {
+  std::vector<int> values;
+  for (const std::string& item : SplitList(list)) {
+    values.push_back(std::stoi(item));
+  }
+  return values;
+}
+
+void PrintUsage(const char* program) {
+  printf("Usage: %s [options]\n", program);
+  printf("       --grids 8,16,...      cloth grid sizes (default 8 to 512)\n");
+  printf("       --precision float,double,mixed  (default float)\n");
+  printf("       --threads 0,2,...     thread counts, 0 is serial "
+         "(default 0); include 0\n"
+         "                             to report speedups\n");
+  printf("       --dt S                integrator step (default 0.001)\n");
+  printf("       --min-time S          minimum time per case (default 0.2)\n");
+  printf("       --filter TEXT         only cases whose name contains TEXT\n");
+  printf("       --output FILE         write JSON to FILE instead of "
+         "stdout\n");
+}
+
+BenchmarkOptions ParseOptions(int argc, char** argv) {
+  BenchmarkOptions options;
+  for (int a = 1; a < argc; a++) {
+    std::string flag = argv[a];
+    if (a + 1 == argc) {
+      throw std::runtime_error("Missing value for " + flag + ".");
+    }
+    std::string value = argv[++a];
+    if (flag == "--grids") {
+      options.grid_sizes = ParseIntList(value);
+    } else if (flag == "--precision") {
+      options.precisions.clear();
+      for (const std::string& name : SplitList(value)) {
+        options.precisions.push_back(ParsePrecisionMode(name));
+      }
+    } else if (flag == "--threads") {
+      options.thread_counts = ParseIntList(value);
+    } else if (flag == "--dt") {
+      options.integration_step = std::stof(value);
+    } else if (flag == "--min-time") {
+      options.min_time = std::stod(value);
+    } else if (flag == "--filter") {
+      options.filter = value;
+    } else if (flag == "--output") {
+      options.output = value;
+    } else {
+      throw std::runtime_error("Unrecognized option: " + flag + ".");
+    }
+  }
+  return options;
+}
+
+typedef std::function<int64_t(int)> RunFunction;
+
+class BenchmarkRunner {
+ public:
+  explicit BenchmarkRunner(const BenchmarkOptions& options)
+      : options_(options) {
+  }
+
+  // Runs one case. |setup| builds the case and returns its run function,
+  // which runs a batch of |n| iterations (steps or frames) and returns the
+  // number of simulation steps taken. Whatever |setup| allocates, plus what
+  // a first warm-up iteration allocates, counts as the footprint.
+  void Run(const std::string& name,
+           PrecisionMode precision,
+           int grid_size,
+           int num_threads,
+           size_t num_particles,
+           const std::function<RunFunction()>& setup) {
+    if (name.find(options_.filter) == std::string::npos) {
+      return;
+    }
+    fprintf(stderr, "%-28s %-6s grid %4d threads %d\n", name.c_str(),
+            GetPrecisionModeName(precision), grid_size, num_threads);
+    int64_t bytes_before = GetLiveHeapBytes();
+    RunFunction run = setup();
+    run(1);
+    int64_t footprint = GetLiveHeapBytes() - bytes_before;
+
+    // Double the batch until a batch takes at least min_time.
+    int batch = 1;
+    int64_t steps = 0;
+    double seconds = 0.0;
+    uint64_t allocations = 0;
+    while (true) {
+      uint64_t allocations_before = GetNumAllocations();
+      auto start = std::chrono::steady_clock::now();
+      steps = run(batch);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      seconds = elapsed.count();
+      allocations = GetNumAllocations() - allocations_before;
+      if (seconds >= options_.min_time || batch >= (1 << 24)) {
+        break;
+      }
+      batch *= 2;
+    }
+
+    BenchmarkResult result;
+    result.name = name;
+    result.precision = precision;
+    result.grid_size = grid_size;
+    result.num_threads = num_threads;
+    result.num_particles = num_particles;
+    result.num_steps = steps;
+    result.seconds = seconds;
+    result.allocations_per_step = static_cast<double>(allocations) / steps;
+    result.footprint_bytes = footprint;
+    results_.push_back(result);
+  }
+
+  // Time per step of |result| over that of the same case run serially, or 0
+  // if the serial run is not among the results.
+  double ComputeSpeedup(const BenchmarkResult& result) const {
+    for (const BenchmarkResult& serial : results_) {
+      if (serial.num_threads == 0 && serial.name == result.name &&
+          serial.precision == result.precision &&
+          serial.grid_size == result.grid_size) {
+        return (serial.seconds / serial.num_steps) /
+               (result.seconds / result.num_steps);
+      }
+    }
+    return 0.0;
+  }
+
+  void WriteJson(FILE* file) const {
+    fprintf(file, "{\n  \"format_version\": 1,\n");
+    fprintf(file, "  \"integration_step\": %g,\n", options_.integration_step);
+    fprintf(file, "  \"results\": [");
+    for (size_t r = 0; r < results_.size(); r++) {
+      const BenchmarkResult& result = results_[r];
+      double particle_steps =
+          static_cast<double>(result.num_particles) * result.num_steps;
+      double speedup = ComputeSpeedup(result);
+      char speedup_text[32] = "null";
+      if (speedup > 0.0) {
+        snprintf(speedup_text, sizeof(speedup_text), "%.3f", speedup);
+      }
+      fprintf(file,
+              "%s\n    {\"name\": \"%s\", \"precision\": \"%s\", "
+              "\"grid_size\": %d, \"threads\": %d, \"particles\": %zu, "
+              "\"steps\": %lld, \"seconds\": %.6f, "
+              "\"ns_per_particle_step\": %.3f, \"speedup\": %s, "
+              "\"allocations_per_step\": %.3f, "
+              "\"footprint_bytes\": %lld}",
+              r == 0 ? "" : ",", result.name.c_str(),
+              GetPrecisionModeName(result.precision), result.grid_size,
+              result.num_threads, result.num_particles,
+              static_cast<long long>(result.num_steps), result.seconds,
+              result.seconds * 1e9 / particle_steps, speedup_text,
+              result.allocations_per_step,
+              static_cast<long long>(result.footprint_bytes));
+    }
+    fprintf(file, "\n  ]\n}\n");
+  }
+
+ private:
+  const BenchmarkOptions& options_;
+  std::vector<BenchmarkResult> results_;
+};
+
+// State and system shared by the steps of one case. Kept on the heap so
+// that the footprint covers them.
+template <class TSystem>
+struct CaseData {
+  typedef typename TSystem::State State;
+
+  SimulationScene<TSystem> scene;
+  State state;
+  State derivative;
+  IntegratorWorkspace<State> workspace;
+  std::unique_ptr<IntegratorBase<TSystem, State>> integrator;
+  std::unique_ptr<ClothSolverBase> solver;
+  std::vector<typename State::Vec3> previous_positions;
+  double time = 0.0;
+};
+
+template <class TSystem>
+std::shared_ptr<CaseData<TSystem>> MakeCase(
+    int grid_size,
+    const std::shared_ptr<ThreadPool>& pool) {
+  auto data = std::make_shared<CaseData<TSystem>>();
+  data->scene = BuildClothScene<TSystem>(grid_size);
+  data->scene.system->SetThreadPool(pool);
+  data->state = data->scene.initial_state;
+  data->previous_positions = data->state.positions;
+  return data;
+}
+
+template <class TSystem>
+void AdvanceSteps(CaseData<TSystem>& data, float step, int num_steps) {
+  data.integrator->IntegrateSteps(*data.scene.system, data.state, data.time,
+                                  step, num_steps, data.workspace);
+  data.time += num_steps * static_cast<double>(step);
+}
+
+// Float cases may use a cloth solver instead of the integrator.
+void AdvanceSteps(CaseData<PendulumSystem>& data, float step, int num_steps) {
+  if (data.solver == nullptr) {
+    AdvanceSteps<PendulumSystem>(data, step, num_steps);
+    return;
+  }
+  for (int s = 0; s < num_steps; s++) {
+    data.solver->Step(data.state, data.time, step);
+    data.time += step;
+  }
+}
+
+// One frame of ClothNode::Update: the scheduled steps, the copy of the
+// positions for blending, and a fresh array of blended render positions.
+// Returns the number of steps taken.
+template <class TSystem>
+int AdvanceFrame(CaseData<TSystem>& data,
+                 FixedStepScheduler& scheduler,
+                 float step) {
+  int steps = scheduler.Advance(kFrameTime);
+  if (steps > 0) {
+    AdvanceSteps(data, step, steps - 1);
+    data.previous_positions = data.state.positions;
+    AdvanceSteps(data, step, 1);
+  }
+  std::unique_ptr<std::vector<glm::vec3>> positions(
+      new std::vector<glm::vec3>());
+  float alpha = scheduler.GetAlpha();
+  for (size_t i = 0; i < data.state.positions.size(); i++) {
+    positions->push_back(glm::mix(glm::vec3(data.previous_positions[i]),
+                                  glm::vec3(data.state.positions[i]), alpha));
+  }
+  return steps;
+}
+
+// The cloth with a force module of every kind: the mass-spring forces, the
+// breeze, a penalty force from a sphere resting in its middle, and a fan
+// blowing on its lower half as a user force.
+template <class TSystem>
+std::shared_ptr<CaseData<TSystem>> MakeAllForcesCase(
+    int grid_size,
+    const std::shared_ptr<ThreadPool>& pool) {
+  typedef typename TSystem::State State;
+  typedef typename State::Scalar Scalar;
+  typedef typename State::Vec3 Vec3;
+  auto data = MakeCase<TSystem>(grid_size, pool);
+  TSystem& system = *data->scene.system;
+  AddBreeze(system);
+  const float spacing = 0.25f;
+  system.AddForce(std::make_shared<ColliderForceT<Scalar>>(
+      std::make_shared<SphereCollider>(
+          0.5f, KinematicPath(std::vector<Keyframe>{Keyframe{
+                    0.0, glm::vec3(0.0f, -0.5f * spacing * grid_size, 0.2f)}})),
+      1000.0f, 10.0f, 0.02f));
+  const Scalar height = -0.5f * spacing * grid_size;
+  system.AddForce(std::make_shared<UserForceT<Scalar>>(
+      "fan", [height](const ForceContext& context, const State& state,
+                      double time, std::vector<Vec3>& forces) {
+        context.ParallelFor(forces.size(), [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++) {
+            if (state.positions[i].y < height) {
+              forces[i].z += Scalar(0.5);
+            }
+          }
+        });
+      }));
+  return data;
+}
+
+// A run function that advances |n| frames.
+template <class TSystem>
+RunFunction MakeFrameRun(std::shared_ptr<CaseData<TSystem>> data,
+                         float step) {
+  auto scheduler = std::make_shared<FixedStepScheduler>(step);
+  return [data, scheduler, step](int n) {
+    int64_t steps = 0;
+    for (int f = 0; f < n; f++) {
+      steps += AdvanceFrame(*data, *scheduler, step);
+    }
+    return steps;
+  };
+}
+
+// A bumpy sphere of about 100k triangles and radius 0.5 resting where the
+// sphere of the collision/sphere case is, as a mesh or as a distance grid.
+std::shared_ptr<Collider> BuildRestingProp(int grid_size,
+                                           bool use_grid,
+                                           ThreadPool* pool) {
+  const float spacing = 0.25f;
+  std::vector<glm::vec3> positions;
+  std::vector<unsigned int> indices;
+  BuildBumpySphereMesh(160, positions, indices);
+  for (glm::vec3& position : positions) {
+    position *= 0.5f;
+  }
+  KinematicPath path(std::vector<Keyframe>{
+      Keyframe{0.0, glm::vec3(0.0f, -0.5f * spacing * grid_size, 0.2f)}});
+  auto mesh = std::make_shared<MeshCollider>(positions, indices, 0.25f, path);
+  if (!use_grid) {
+    return mesh;
+  }
+  return std::make_shared<SdfCollider>(
+      DistanceGrid::Bake(*mesh, 128, 0.1f, pool), path);
+}
+
+template <PrecisionMode mode>
+void RunCases(BenchmarkRunner& runner,
+              const BenchmarkOptions& options,
+              int grid_size,
+              int num_threads) {
+  typedef typename PrecisionTraits<mode>::PendulumSystemType SystemType;
+  typedef typename SystemType::State State;
+  std::shared_ptr<ThreadPool> pool;
+  if (num_threads > 0) {
+    pool = std::make_shared<ThreadPool>(num_threads);
+  }
+  const size_t num_particles = grid_size * grid_size;
+  const float dt = options.integration_step;
+
+  runner.Run("derivative", mode, grid_size, num_threads, num_particles, [&]() {
+    auto data = MakeCase<SystemType>(grid_size, pool);
+    return RunFunction([data](int n) {
+      for (int s = 0; s < n; s++) {
+        data->scene.system->ComputeTimeDerivative(data->state, 0.0,
+                                                  data->derivative);
+      }
+      return static_cast<int64_t>(n);
+    });
+  });
+
+  // The same with the breeze blowing, sampled from its grid or evaluated
+  // at every particle. Time advances a step per evaluation, so the grid is
+  // rebaked at least as often as in a simulation.
+  const char* wind_names[] = {"derivative/wind_exact", "derivative/wind"};
+  for (int cached = 0; cached < 2; cached++) {
+    runner.Run(wind_names[cached], mode, grid_size, num_threads,
+               num_particles, [&]() {
+                 auto data = MakeCase<SystemType>(grid_size, pool);
+                 AddBreeze(*data->scene.system, cached != 0);
+                 return RunFunction([data, dt](int n) {
+                   for (int s = 0; s < n; s++) {
+                     data->scene.system->ComputeTimeDerivative(
+                         data->state, data->time, data->derivative);
+                     data->time += dt;
+                   }
+                   return static_cast<int64_t>(n);
+                 });
+               });
+  }
+
+  // The cached breeze at the times of the four RK4 stages of each step,
+  // which the wind field samples twice.
+  runner.Run("derivative/wind_rk4", mode, grid_size, num_threads,
+             num_particles, [&]() {
+               auto data = MakeCase<SystemType>(grid_size, pool);
+               AddBreeze(*data->scene.system);
+               auto stage = std::make_shared<int>(0);
+               return RunFunction([data, dt, stage](int n) {
+                 const double stage_times[] = {0.0, 0.5 * dt, 0.5 * dt, dt};
+                 for (int s = 0; s < n; s++) {
+                   data->scene.system->ComputeTimeDerivative(
+                       data->state, data->time + stage_times[*stage],
+                       data->derivative);
+                   if (++*stage == 4) {
+                     *stage = 0;
+                     data->time += dt;
+                   }
+                 }
+                 return static_cast<int64_t>(n);
+               });
+             });
+
+  // Each force module of MakeAllForcesCase() on its own, at the same time
+  // steps as above. Modules only add to the forces, so they are not cleared.
+  std::vector<std::string> module_names;
+  {
+    auto prototype = MakeAllForcesCase<SystemType>(grid_size, pool);
+    for (const auto& force : prototype->scene.system->GetForces()) {
+      module_names.push_back(std::string("force/") + force->GetName());
+    }
+  }
+  for (size_t m = 0; m < module_names.size(); m++) {
+    const std::string& name = module_names[m];
+    runner.Run(name, mode, grid_size, num_threads, num_particles, [&]() {
+      auto data = MakeAllForcesCase<SystemType>(grid_size, pool);
+      return RunFunction([data, m, dt](int n) {
+        const SystemType& system = *data->scene.system;
+        ForceContext context = system.GetForceContext();
+        std::vector<typename State::Vec3>& forces = data->derivative.velocities;
+        forces.resize(data->state.positions.size());
+        for (int s = 0; s < n; s++) {
+          system.GetForces()[m]->AccumulateForces(context, data->state,
+                                                  data->time, forces);
+          data->time += dt;
+        }
+        return static_cast<int64_t>(n);
+      });
+    });
+  }
+
+  for (IntegratorType type : kIntegratorTypes) {
+    std::string name = std::string("integrator/") + GetIntegratorName(type);
+    runner.Run(name, mode, grid_size, num_threads, num_particles, [&]() {
+      auto data = MakeCase<SystemType>(grid_size, pool);
+      data->integrator =
+          IntegratorFactory::CreateIntegrator<SystemType, State>(type);
+      data->workspace.adaptive_step = dt;
+      return RunFunction([data, dt](int n) {
+        AdvanceSteps(*data, dt, n);
+        return static_cast<int64_t>(n);
+      });
+    });
+  }
+
+  // A sphere of fixed size resting in the middle of the cloth: the hash is
+  // rebuilt over all particles, but only the ones near the sphere are tested.
+  runner.Run("collision/sphere", mode, grid_size, num_threads, num_particles,
+             [&]() {
+               auto data = MakeCase<SystemType>(grid_size, pool);
+               auto collisions = std::make_shared<CollisionStage>();
+               collisions->SetThreadPool(pool);
+               const float spacing = 0.25f;
+               collisions->AddCollider(std::make_shared<SphereCollider>(
+                   0.5f, KinematicPath(std::vector<Keyframe>{Keyframe{
+                             0.0, glm::vec3(0.0f, -0.5f * spacing * grid_size,
+                                            0.2f)}})));
+               return RunFunction([data, collisions](int n) {
+                 for (int s = 0; s < n; s++) {
+                   collisions->Apply(data->scene.system->GetParticles(),
+                                     data->state, 0.0);
+                 }
+                 return static_cast<int64_t>(n);
+               });
+             });
+
+  // The same, with a bumpy sphere of about 100k triangles in place of the
+  // analytic one, queried through its BVH and through a distance grid. The
+  // BVH and the grid are built in the setup, outside the timing.
+  const char* prop_names[] = {"collision/mesh", "collision/sdf"};
+  for (int use_grid = 0; use_grid < 2; use_grid++) {
+    runner.Run(prop_names[use_grid], mode, grid_size, num_threads,
+               num_particles, [&]() {
+                 auto data = MakeCase<SystemType>(grid_size, pool);
+                 auto collisions = std::make_shared<CollisionStage>();
+                 collisions->SetThreadPool(pool);
+                 collisions->AddCollider(
+                     BuildRestingProp(grid_size, use_grid != 0, pool.get()));
+                 return RunFunction([data, collisions](int n) {
+                   for (int s = 0; s < n; s++) {
+                     collisions->Apply(data->scene.system->GetParticles(),
+                                       data->state, 0.0);
+                   }
+                   return static_cast<int64_t>(n);
+                 });
+               });
+  }
+
+  // Self-collision of the hanging cloth, where every particle has close
+  // neighbors to check but few pairs are in contact.
+  runner.Run("collision/self", mode, grid_size, num_threads, num_particles,
+             [&]() {
+               auto data = MakeCase<SystemType>(grid_size, pool);
+               auto collisions = std::make_shared<CollisionStage>();
+               collisions->SetThreadPool(pool);
+               collisions->SetSelfCollision(
+                   data->scene.system->GetSprings(),
+                   data->scene.system->GetNumParticles(),
+                   kClothSelfCollisionDistance);
+               return RunFunction([data, collisions](int n) {
+                 for (int s = 0; s < n; s++) {
+                   collisions->Apply(data->scene.system->GetParticles(),
+                                     data->state, 0.0);
+                 }
+                 return static_cast<int64_t>(n);
+               });
+             });
+
+  runner.Run("frame/mass_spring_rk4", mode, grid_size, num_threads,
+             num_particles, [&]() {
+               auto data = MakeCase<SystemType>(grid_size, pool);
+               data->integrator =
+                   IntegratorFactory::CreateIntegrator<SystemType, State>(
+                       IntegratorType::RK4);
+               return MakeFrameRun(data, dt);
+             });
+}
+
+// The dedicated cloth solvers only exist in float, and take one step per
+// frame as in the viewer.
+void RunSolverFrames(BenchmarkRunner& runner, int grid_size, int num_threads) {
+  std::shared_ptr<ThreadPool> pool;
+  if (num_threads > 0) {
+    pool = std::make_shared<ThreadPool>(num_threads);
+  }
+  const ClothSolverType types[] = {ClothSolverType::XPBD,
+                                   ClothSolverType::ProjectiveDynamics};
+  const char* names[] = {"frame/xpbd", "frame/projective_dynamics"};
+  for (int t = 0; t < 2; t++) {
+    if (types[t] == ClothSolverType::ProjectiveDynamics &&
+        grid_size > kMaxProjectiveGridSize) {
+      continue;
+    }
+    runner.Run(names[t], PrecisionMode::Float, grid_size, num_threads,
+               grid_size * grid_size, [&]() {
+                 auto data = MakeCase<PendulumSystem>(grid_size, pool);
+                 data->solver = ClothSolverFactory::CreateSolver(
+                     types[t], data->scene.system, kFrameTime);
+                 return MakeFrameRun(data, kFrameTime);
+               });
+  }
+}
+
+// Pendulum chains stepped with RK4, as one PendulumEnsemble and as separate
+// states of a single PendulumSystem. There are grid_size^2 / 4 chains of 4
+// particles, as many particles as the cloth of the same grid size.
+struct EnsembleCaseData {
+  std::unique_ptr<PendulumEnsemble> ensemble;
+  ParticleState state;
+  IntegratorWorkspace<ParticleState> workspace;
+  std::unique_ptr<IntegratorBase<PendulumEnsemble, ParticleState>> integrator;
+  double time = 0.0;
+};
+
+struct SeparateCaseData {
+  SimulationScene<PendulumSystem> scene;
+  std::vector<ParticleState> states;
+  std::vector<IntegratorWorkspace<ParticleState>> workspaces;
+  std::unique_ptr<IntegratorBase<PendulumSystem, ParticleState>> integrator;
+  double time = 0.0;
+};
+
+void RunEnsembleCases(BenchmarkRunner& runner,
+                      const BenchmarkOptions& options,
+                      int grid_size,
+                      int num_threads) {
+  std::shared_ptr<ThreadPool> pool;
+  if (num_threads > 0) {
+    pool = std::make_shared<ThreadPool>(num_threads);
+  }
+  const int num_instances = std::max(1, grid_size * grid_size / 4);
+  const size_t num_particles = 4 * static_cast<size_t>(num_instances);
+  const float dt = options.integration_step;
+
+  runner.Run("ensemble/pendulum_rk4", PrecisionMode::Float, grid_size,
+             num_threads, num_particles, [&]() {
+               auto data = std::make_shared<EnsembleCaseData>();
+               auto scene = BuildPendulumScene<PendulumSystem>();
+               data->ensemble.reset(
+                   new PendulumEnsemble(*scene.system, num_instances));
+               data->ensemble->SetThreadPool(pool);
+               data->state = data->ensemble->MakeState(scene.initial_state);
+               data->integrator = IntegratorFactory::CreateIntegrator<
+                   PendulumEnsemble, ParticleState>(IntegratorType::RK4);
+               return RunFunction([data, dt](int n) {
+                 data->integrator->IntegrateSteps(*data->ensemble, data->state,
+                                                  data->time, dt, n,
+                                                  data->workspace);
+                 data->time += n * static_cast<double>(dt);
+                 return static_cast<int64_t>(n);
+               });
+             });
+
+  // The baseline the ensemble replaces; always serial, as each chain is too
+  // small to split across threads.
+  runner.Run("ensemble/separate_rk4", PrecisionMode::Float, grid_size,
+             num_threads, num_particles, [&]() {
+               auto data = std::make_shared<SeparateCaseData>();
+               data->scene = BuildPendulumScene<PendulumSystem>();
+               data->states.assign(num_instances, data->scene.initial_state);
+               data->workspaces.resize(num_instances);
+               data->integrator = IntegratorFactory::CreateIntegrator<
+                   PendulumSystem, ParticleState>(IntegratorType::RK4);
+               return RunFunction([data, dt](int n) {
+                 for (size_t m = 0; m < data->states.size(); m++) {
+                   data->integrator->IntegrateSteps(
+                       *data->scene.system, data->states[m], data->time, dt, n,
+                       data->workspaces[m]);
+                 }
+                 data->time += n * static_cast<double>(dt);
+                 return static_cast<int64_t>(n);
+               });
+             });
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1 && std::string(argv[1]) == "--help") {
+    PrintUsage(argv[0]);
+    return 0;
+  }
+  try {
+    BenchmarkOptions options = ParseOptions(argc, argv);
+    BenchmarkRunner runner(options);
+    for (int grid_size : options.grid_sizes) {
+      for (int num_threads : options.thread_counts) {
+        for (PrecisionMode precision : options.precisions) {
+          switch (precision) {
+            case PrecisionMode::Float:
+              RunCases<PrecisionMode::Float>(runner, options, grid_size,
+                                             num_threads);
+              RunSolverFrames(runner, grid_size, num_threads);
+              RunEnsembleCases(runner, options, grid_size, num_threads);
+              break;
+            case PrecisionMode::Double:
+              RunCases<PrecisionMode::Double>(runner, options, grid_size,
+                                              num_threads);
+              break;
+            case PrecisionMode::Mixed:
+              RunCases<PrecisionMode::Mixed>(runner, options, grid_size,
+                                             num_threads);
+              break;
+          }
+        }
+      }
+    }
+
+    FILE* file = stdout;
+    if (!options.output.empty()) {
+      file = fopen(options.output.c_str(), "w");
+      if (file == nullptr) {
+        throw std::runtime_error("Cannot open " + options.output + ".");
+      }
+    }
+    runner.WriteJson(file);
+    if (file != stdout) {
+      fclose(file);
+    }
+  } catch (const std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
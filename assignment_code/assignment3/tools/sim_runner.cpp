@@ -0,0 +1,390 @@
+// Runs the scenes of the viewer without a window and reports wall time and a
+// checksum of the final state, for headless machines and regression checks.
+// With --drag off, the energy drift of the mass-spring scenes measures the
+// error of the integrator.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "ClothSolverFactory.hpp"
+#include "ClothSolverType.hpp"
+#include "CollisionStage.hpp"
+#include "IntegratorFactory.hpp"
+#include "IntegratorType.hpp"
+#include "PrecisionMode.hpp"
+#include "SimulationScenes.hpp"
+#include "ThreadPool.hpp"
+#include "TrajectoryRecorder.hpp"
+
+using namespace GLOO;
+
+namespace {
+struct RunOptions {
+  IntegratorType integrator_type;
+  float integration_step;
+  int num_steps;
+  std::string scene = "all";
+  ClothSolverType cloth_solver_type = ClothSolverType::MassSpring;
+  PrecisionMode precision = PrecisionMode::Float;
+  int grid_size = kDefaultClothGridSize;
+  int num_threads = 0;
+  std::string record_path;
+  bool sphere = false;
+  bool self_collision = false;
+  bool wind = false;
+  bool drag = true;
+};
+
+void PrintUsage(const char* program) {
+  printf("Usage: %s <e|t|r|i|d|s|v> <timestep> <steps> [options]\n", program);
+  printf("       Integrator letters as for the viewer.\n");
+  printf("       --scene all|circular|pendulum|cloth  (default all)\n");
+  printf("       --cloth m|x|p     cloth solver letter (default m)\n");
+  printf("       --grid N          cloth grid size (default %d)\n",
+         kDefaultClothGridSize);
+  printf("       --precision float|double|mixed  (default float)\n");
+  printf("       --threads N       force evaluation threads (default 0: "
+         "serial)\n");
+  printf("       --record FILE     record the cloth positions of every step "
+         "for replay,\n"
+         "                         or the pendulum's with --scene pendulum\n");
+  printf("       --sphere on|off   swing the viewer's sphere through the "
+         "cloth (default off)\n");
+  printf("       --self-collision on|off  keep the cloth from passing through "
+         "itself (default off)\n");
+  printf("       --wind on|off     blow the viewer's breeze through the cloth "
+         "(default off)\n");
+  printf("       --drag on|off     drag of the pendulum and cloth "
+         "(default on)\n");
+  printf("\n");
+  printf("Try  : %s r 0.005 2000 --scene cloth --grid 32\n", program);
+  printf("Drift: %s v 0.005 2000 --scene pendulum --drag off\n", program);
+}
+
+// Value of an on|off flag. Anything else is an error, so that a typo does
+// not silently turn a feature off.
+bool ParseSwitch(const std::string& flag, const std::string& value) {
+  if (value == "on") {
+    return true;
+  }
+  if (value == "off") {
+    return false;
+  }
+  throw std::runtime_error("Expected on or off for " + flag + ", got " +
+                           value + ".");
+}
+
+RunOptions ParseOptions(int argc, char** argv) {
+  RunOptions options;
+  options.integrator_type = ParseIntegratorType(argv[1][0]);
+  options.integration_step = std::stof(argv[2]);
+  options.num_steps = std::stoi(argv[3]);
+  for (int a = 4; a < argc; a++) {
+    std::string flag = argv[a];
+    if (a + 1 == argc) {
+      throw std::runtime_error("Missing value for " + flag + ".");
+    }
+    std::string value = argv[++a];
+    if (flag == "--scene") {
+      options.scene = value;
+    } else if (flag == "--cloth") {
+      options.cloth_solver_type = ParseClothSolverType(value[0]);
+    } else if (flag == "--grid") {
+      options.grid_size = std::stoi(value);
+    } else if (flag == "--precision") {
+      options.precision = ParsePrecisionMode(value);
+    } else if (flag == "--threads") {
+      options.num_threads = std::stoi(value);
+    } else if (flag == "--record") {
+      options.record_path = value;
+    } else if (flag == "--sphere") {
+      options.sphere = ParseSwitch(flag, value);
+    } else if (flag == "--self-collision") {
+      options.self_collision = ParseSwitch(flag, value);
+    } else if (flag == "--wind") {
+      options.wind = ParseSwitch(flag, value);
+    } else if (flag == "--drag") {
+      options.drag = ParseSwitch(flag, value);
+    } else {
+      throw std::runtime_error("Unrecognized option: " + flag + ".");
+    }
+  }
+  return options;
+}
+
+// FNV-1a over the bytes of the positions and velocities. Equal checksums mean
+// bitwise equal states.
+template <class TState>
+uint64_t Checksum(const TState& state) {
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](const void* data, size_t num_bytes) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t b = 0; b < num_bytes; b++) {
+      hash = (hash ^ bytes[b]) * 1099511628211ull;
+    }
+  };
+  mix(state.FlatPositions(), state.FlatSize() * sizeof(*state.FlatPositions()));
+  mix(state.FlatVelocities(),
+      state.FlatSize() * sizeof(*state.FlatVelocities()));
+  return hash;
+}
+
+template <class TSystem>
+double ComputeEnergy(const TSystem& system,
+                     const typename TSystem::State& state) {
+  return system.ComputeEnergy(state);
+}
+
+// The circular system has no energy; report the radius, which the exact
+// solution conserves.
+template <class T>
+double ComputeEnergy(const SimpleCircularSystemT<T>& system,
+                     const ParticleStateT<T>& state) {
+  return glm::length(state.positions[0]);
+}
+
+// Drift is the change in energy from |initial_state| to |state|.
+template <class TSystem>
+void Report(const char* name,
+            const RunOptions& options,
+            const TSystem& system,
+            const typename TSystem::State& initial_state,
+            const typename TSystem::State& state,
+            double seconds) {
+  double energy = ComputeEnergy(system, state);
+  printf("%-9s %-6s %6zu particles %7d steps %10.3f ms %9.3f us/step  "
+         "energy %+.6e drift %+.3e  checksum %016llx\n",
+         name, GetPrecisionModeName(options.precision), state.positions.size(),
+         options.num_steps, seconds * 1e3, seconds * 1e6 / options.num_steps,
+         energy, energy - ComputeEnergy(system, initial_state),
+         static_cast<unsigned long long>(Checksum(state)));
+}
+
+// Turns off the drag of a mass-spring scene, and with it the pull of any
+// wind on the particles, leaving only conservative forces unless the wind
+// pushes on triangles.
+template <class TSystem>
+void RemoveDrag(TSystem& system) {
+  typedef typename TSystem::State::Scalar Scalar;
+  DragForceT<Scalar>* drag = system.template FindForce<DragForceT<Scalar>>();
+  if (drag != nullptr) {
+    drag->SetDragCoefficient(0.0f);
+  }
+}
+
+// Trajectories are stored in float.
+void RecordFrame(TrajectoryRecorder& recorder, const ParticleState& state) {
+  recorder.Record(state);
+}
+
+template <class T>
+void RecordFrame(TrajectoryRecorder& recorder, const ParticleStateT<T>& state) {
+  recorder.Record(ParticleState(state));
+}
+
+// Records the initial state plus one frame per step of |system|, stored as
+// float; nullptr without --record.
+template <class TSystem>
+std::unique_ptr<TrajectoryRecorder> MakeRecorder(const RunOptions& options,
+                                                 const TSystem& system) {
+  std::unique_ptr<TrajectoryRecorder> recorder;
+  if (!options.record_path.empty()) {
+    recorder.reset(new TrajectoryRecorder(
+        options.record_path, system.GetNumParticles(), 0.0,
+        options.integration_step, ComputeTopologyHash(system),
+        options.num_steps + 1));
+  }
+  return recorder;
+}
+
+template <class TSystem>
+bool ResolveContacts(CollisionStage& collisions,
+                     const TSystem& system,
+                     typename TSystem::State& state,
+                     double time) {
+  return collisions.Apply(system.GetParticles(), state, time);
+}
+
+// Only the mass-spring systems have colliders.
+template <class T>
+bool ResolveContacts(CollisionStage& collisions,
+                     const SimpleCircularSystemT<T>& system,
+                     ParticleStateT<T>& state,
+                     double time) {
+  return false;
+}
+
+// With |recorder| or |collisions|, steps one at a time, resolving contacts
+// and recording the state after each step.
+template <class TSystem>
+void RunIntegrator(const char* name,
+                   const RunOptions& options,
+                   const SimulationScene<TSystem>& scene,
+                   TrajectoryRecorder* recorder = nullptr,
+                   CollisionStage* collisions = nullptr) {
+  typedef typename TSystem::State State;
+  auto integrator = IntegratorFactory::CreateIntegrator<TSystem, State>(
+      options.integrator_type);
+  State state = scene.initial_state;
+  IntegratorWorkspace<State> workspace;
+  workspace.adaptive_step = options.integration_step;
+
+  auto start = std::chrono::steady_clock::now();
+  if (recorder != nullptr || collisions != nullptr) {
+    double time = 0.0;
+    if (recorder != nullptr) {
+      RecordFrame(*recorder, state);
+    }
+    for (int s = 0; s < options.num_steps; s++) {
+      integrator->IntegrateSteps(*scene.system, state, time,
+                                 options.integration_step, 1, workspace);
+      time += options.integration_step;
+      if (collisions != nullptr &&
+          ResolveContacts(*collisions, *scene.system, state, time)) {
+        workspace.Invalidate();
+      }
+      if (recorder != nullptr) {
+        RecordFrame(*recorder, state);
+      }
+    }
+  } else {
+    integrator->IntegrateSteps(*scene.system, state, 0.0,
+                               options.integration_step, options.num_steps,
+                               workspace);
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  Report(name, options, *scene.system, scene.initial_state, state,
+         elapsed.count());
+}
+
+// The dedicated cloth solvers are float only.
+void RunClothSolver(const RunOptions& options,
+                    const SimulationScene<PendulumSystem>& scene,
+                    TrajectoryRecorder* recorder,
+                    CollisionStage* collisions) {
+  std::unique_ptr<ClothSolverBase> solver = ClothSolverFactory::CreateSolver(
+      options.cloth_solver_type, scene.system, options.integration_step);
+  ParticleState state = scene.initial_state;
+
+  auto start = std::chrono::steady_clock::now();
+  double time = 0.0;
+  if (recorder != nullptr) {
+    recorder->Record(state);
+  }
+  for (int s = 0; s < options.num_steps; s++) {
+    solver->Step(state, time, options.integration_step);
+    time += options.integration_step;
+    if (collisions != nullptr) {
+      collisions->Apply(scene.system->GetParticles(), state, time);
+    }
+    if (recorder != nullptr) {
+      recorder->Record(state);
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  Report("cloth", options, *scene.system, scene.initial_state, state,
+         elapsed.count());
+}
+
+template <PrecisionMode mode>
+void RunScenes(const RunOptions& options) {
+  typedef typename PrecisionTraits<mode>::PendulumSystemType SystemType;
+  typedef typename SystemType::State::Scalar Scalar;
+  std::shared_ptr<ThreadPool> pool;
+  if (options.num_threads > 0) {
+    pool = std::make_shared<ThreadPool>(options.num_threads);
+  }
+  bool all = options.scene == "all";
+
+  if (all || options.scene == "circular") {
+    RunIntegrator("circular", options,
+                  BuildCircularScene<SimpleCircularSystemT<Scalar>>());
+  }
+  if (all || options.scene == "pendulum") {
+    auto scene = BuildPendulumScene<SystemType>();
+    if (!options.drag) {
+      RemoveDrag(*scene.system);
+    }
+    // With every scene, only the cloth is recorded.
+    std::unique_ptr<TrajectoryRecorder> recorder;
+    if (!all) {
+      recorder = MakeRecorder(options, *scene.system);
+    }
+    RunIntegrator("pendulum", options, scene, recorder.get());
+  }
+  if (all || options.scene == "cloth") {
+    auto scene = BuildClothScene<SystemType>(options.grid_size);
+    scene.system->SetThreadPool(pool);
+    if (!options.drag) {
+      RemoveDrag(*scene.system);
+    }
+    if (options.wind) {
+      AddBreeze(*scene.system);
+    }
+    std::unique_ptr<TrajectoryRecorder> recorder =
+        MakeRecorder(options, *scene.system);
+    std::unique_ptr<CollisionStage> collisions;
+    if (options.sphere || options.self_collision) {
+      collisions.reset(new CollisionStage());
+      collisions->SetThreadPool(pool);
+    }
+    if (options.sphere) {
+      collisions->AddCollider(BuildSwingingSphere(options.grid_size));
+    }
+    if (options.self_collision) {
+      collisions->SetSelfCollision(scene.system->GetSprings(),
+                                   scene.system->GetNumParticles(),
+                                   kClothSelfCollisionDistance);
+    }
+    if (options.cloth_solver_type == ClothSolverType::MassSpring) {
+      RunIntegrator("cloth", options, scene, recorder.get(), collisions.get());
+    } else if (mode == PrecisionMode::Float) {
+      auto float_scene = BuildClothScene<PendulumSystem>(options.grid_size);
+      float_scene.system->SetThreadPool(pool);
+      if (!options.drag) {
+        RemoveDrag(*float_scene.system);
+      }
+      if (options.wind) {
+        AddBreeze(*float_scene.system);
+      }
+      RunClothSolver(options, float_scene, recorder.get(), collisions.get());
+    } else {
+      throw std::runtime_error("The XPBD and projective dynamics solvers only "
+                               "support float precision.");
+    }
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    PrintUsage(argv[0]);
+    return -1;
+  }
+  try {
+    RunOptions options = ParseOptions(argc, argv);
+    switch (options.precision) {
+      case PrecisionMode::Float:
+        RunScenes<PrecisionMode::Float>(options);
+        break;
+      case PrecisionMode::Double:
+        RunScenes<PrecisionMode::Double>(options);
+        break;
+      case PrecisionMode::Mixed:
+        RunScenes<PrecisionMode::Mixed>(options);
+        break;
+    }
+  } catch (const std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
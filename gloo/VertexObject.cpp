@@ -16,6 +16,14 @@ void VertexObject::UpdatePositions(std::unique_ptr<PositionArray> positions) {
   vertex_array_->UpdatePositions(*positions_);
 }
 
+void VertexObject::StreamPositions(const glm::vec3* positions, size_t count) {
+  if (positions_ == nullptr || positions_->size() != count) {
+    throw std::runtime_error(
+        "Streamed positions must match the size of the position array!");
+  }
+  vertex_array_->UpdatePositions(positions, count);
+}
+
 void VertexObject::UpdateIndices(std::unique_ptr<IndexArray> indices) {
   if (indices_ == nullptr) {
     vertex_array_->CreateIndexBuffer();
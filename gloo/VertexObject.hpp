@@ -18,6 +18,12 @@ class VertexObject {
   void UpdateTexCoord(std::unique_ptr<TexCoordArray> tex_coords);
   void UpdateIndices(std::unique_ptr<IndexArray> indices);
 
+  // Uploads |count| positions straight from caller-owned memory (e.g. a
+  // memory-mapped file) without keeping a CPU copy. GetPositions() keeps
+  // returning the array of the last UpdatePositions(), so |count| must match
+  // its size.
+  void StreamPositions(const glm::vec3* positions, size_t count);
+
   bool HasPositions() const {
     return positions_ != nullptr;
   }
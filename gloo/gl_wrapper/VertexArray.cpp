@@ -78,6 +78,11 @@ void VertexArray::UpdatePositions(const PositionArray& positions) const {
   pos_buf_->Update(positions);
 }
 
+void VertexArray::UpdatePositions(const glm::vec3* positions,
+                                  size_t count) const {
+  pos_buf_->Update(positions, count);
+}
+
 void VertexArray::UpdateNormals(const NormalArray& normals) const {
   normal_buf_->Update(normals);
 }
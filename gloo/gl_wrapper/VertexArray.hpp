@@ -33,6 +33,7 @@ class VertexArray : public IBindable {
   void CreateTexCoordBuffer();
   void CreateIndexBuffer();
   void UpdatePositions(const PositionArray& positions) const;
+  void UpdatePositions(const glm::vec3* positions, size_t count) const;
   void UpdateNormals(const NormalArray& normals) const;
   void UpdateColors(const ColorArray& colors) const;
   void UpdateTexCoords(const TexCoordArray& tex_coords) const;
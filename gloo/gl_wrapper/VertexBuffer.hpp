@@ -16,6 +16,8 @@ class VertexBuffer : public BindableBuffer {
  public:
   VertexBuffer(GLenum usage);
   void Update(const std::vector<T>& array);
+  // Uploads |count| elements straight from |data|.
+  void Update(const T* data, size_t count);
   size_t GetSize() const {
     return size_;
   }
@@ -32,10 +34,14 @@ VertexBuffer<T, target>::VertexBuffer(GLenum usage)
 
 template <class T, GLenum target>
 void VertexBuffer<T, target>::Update(const std::vector<T>& array) {
+  Update(array.data(), array.size());
+}
+
+template <class T, GLenum target>
+void VertexBuffer<T, target>::Update(const T* data, size_t count) {
   BindGuard bg(this);
-  GL_CHECK(
-      glBufferData(target_, sizeof(T) * array.size(), array.data(), usage_));
-  size_ = array.size();
+  GL_CHECK(glBufferData(target_, sizeof(T) * count, data, usage_));
+  size_ = count;
 }
 }  // namespace GLOO
 